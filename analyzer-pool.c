@@ -0,0 +1,232 @@
+#include "analyzer-pool.h"
+#include "file-properties.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+// Analyseurs en threads du processus principal (au lieu de processus fils) : les entrées des listes sont
+// lues et complétées sur place, sans message. Chaque thread a sa file de tâches (des suites de
+// ANALYZER_TASK_ENTRIES entrées) et vole dans celles des autres quand la sienne est vide.
+
+typedef struct {
+    files_list_entry_t *first;
+    size_t count;
+} analyzer_task_t;
+
+/*!
+ * @brief next_task gets a task: from the thread's own deque first, then by stealing
+ * @param self is the thread looking for work
+ * @return the task, NULL if there is none
+ */
+static analyzer_task_t *next_task(analyzer_thread_t *self) {
+    analyzer_pool_t *pool = self->pool;
+    analyzer_task_t *task = work_deque_pop(&self->deque);
+    for (int i = 1; !task && i < pool->threads_count; ++i) {       //vol chez les autres threads
+        task = work_deque_steal(&pool->threads[(self->id + i) % pool->threads_count].deque);
+    }
+    if (task) {
+        atomic_fetch_sub(&pool->available, 1);
+    }
+    return task;
+}
+
+/*!
+ * @brief analyzer_thread_loop is the function of the analyzer threads
+ * @param parameters is a pointer to the analyzer_thread_t of the thread
+ */
+static void *analyzer_thread_loop(void *parameters) {
+    analyzer_thread_t *self = (analyzer_thread_t *)parameters;
+    analyzer_pool_t *pool = self->pool;
+
+    while (true) {
+        analyzer_task_t *task = next_task(self);
+        if (task) {
+            files_list_entry_t *entry = task->first;
+            for (size_t i = 0; i < task->count && entry; ++i, entry = entry->next) {
+                if (get_file_stats(entry) == -1) {      //l'entrée est gardée, comme en mode séquentiel
+                    atomic_fetch_add(&pool->errors, 1);
+                }
+            }
+            free(task);
+
+            if (atomic_fetch_sub(&pool->pending, 1) == 1) {        //dernière tâche : réveil de celui qui attend
+                pthread_mutex_lock(&pool->lock);
+                pthread_cond_broadcast(&pool->done_cond);
+                pthread_mutex_unlock(&pool->lock);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->available) == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        bool finished = pool->stopping && atomic_load(&pool->available) == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (finished) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * @brief init_analyzer_pool starts the analyzer threads, waiting for tasks
+ * @param pool is a pointer to the pool to initialize
+ * @param threads_count is the number of threads
+ * @return 0 if all went good, -1 else
+ */
+int init_analyzer_pool(analyzer_pool_t *pool, int threads_count) {
+    if (!pool) {
+        printf("Invalid parameters\n");
+        return -1;
+    }
+    if (threads_count < 1) {
+        threads_count = 1;
+    }
+
+    pool->threads = calloc(threads_count, sizeof(analyzer_thread_t));
+    if (!pool->threads) {
+        printf("out of memory\n");
+        return -1;
+    }
+    pool->threads_count = 0;
+    pool->next_thread = 0;
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->available, 0);
+    atomic_init(&pool->errors, 0);
+    pool->stopping = false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    for (int i = 0; i < threads_count; ++i) {       //les files existent avant que les threads ne volent
+        if (init_work_deque(&pool->threads[i].deque) == -1) {
+            for (int j = 0; j < i; ++j) {
+                destroy_work_deque(&pool->threads[j].deque);
+            }
+            free(pool->threads);
+            pool->threads = NULL;
+            return -1;
+        }
+        pool->threads[i].pool = pool;
+        pool->threads[i].id = i;
+    }
+    pool->threads_count = threads_count;
+
+    int started = 0;
+    for (; started < threads_count; ++started) {
+        if (pthread_create(&pool->threads[started].thread, NULL, analyzer_thread_loop, &pool->threads[started]) != 0) {
+            printf("Erreur lors de la création d'un thread\n");
+            break;
+        }
+    }
+    for (int i = started; i < threads_count; ++i) {         //files sans thread : vidées par les vols
+        pool->threads[i].thread = 0;
+    }
+    if (started == 0) {
+        clear_analyzer_pool(pool);
+        return -1;
+    }
+    return 0;
+}
+
+/*!
+ * @brief submit_files_list hands all the entries of a list to the analyzers (get_file_stats on each)
+ * It returns at once: use wait_analyzer_pool before using the entries.
+ * @param pool is a pointer to the pool
+ * @param list is the list to analyze
+ * @return 0 if all went good, -1 else (the entries that could not be submitted are analyzed here)
+ */
+int submit_files_list(analyzer_pool_t *pool, files_list_t *list) {
+    if (!pool || !list) {
+        printf("Invalid parameters\n");
+        return -1;
+    }
+
+    int result = 0;
+    files_list_entry_t *cursor = list->head;
+    while (cursor) {
+        analyzer_task_t *task = malloc(sizeof(analyzer_task_t));
+        if (!task) {
+            printf("out of memory\n");
+            result = -1;
+            break;
+        }
+        task->first = cursor;
+        task->count = 0;
+        while (cursor && task->count < ANALYZER_TASK_ENTRIES) {
+            cursor = cursor->next;
+            task->count++;
+        }
+
+        atomic_fetch_add(&pool->pending, 1);
+        atomic_fetch_add(&pool->available, 1);     //avant la publication : un voleur le décrémente aussitôt
+        analyzer_thread_t *thread = &pool->threads[pool->next_thread];
+        pool->next_thread = (pool->next_thread + 1) % pool->threads_count;
+        if (work_deque_push(&thread->deque, task) == -1) {
+            atomic_fetch_sub(&pool->available, 1);
+            atomic_fetch_sub(&pool->pending, 1);
+            cursor = task->first;
+            free(task);
+            result = -1;
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (; cursor; cursor = cursor->next) {         //reste non soumis : analysé par l'appelant
+        if (get_file_stats(cursor) == -1) {
+            atomic_fetch_add(&pool->errors, 1);
+        }
+    }
+    return result;
+}
+
+/*!
+ * @brief wait_analyzer_pool waits until all the submitted entries are analyzed
+ * @param pool is a pointer to the pool
+ * @return the number of entries in error since the last wait, 0 if all went good
+ */
+int wait_analyzer_pool(analyzer_pool_t *pool) {
+    if (!pool) {
+        return -1;
+    }
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&pool->pending) > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return atomic_exchange(&pool->errors, 0);
+}
+
+/*!
+ * @brief clear_analyzer_pool stops the analyzer threads, once their tasks are done, and releases the pool
+ * @param pool is a pointer to the pool
+ */
+void clear_analyzer_pool(analyzer_pool_t *pool) {
+    if (!pool || !pool->threads) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->threads_count; ++i) {
+        if (pool->threads[i].thread) {
+            pthread_join(pool->threads[i].thread, NULL);
+        }
+        destroy_work_deque(&pool->threads[i].deque);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->threads_count = 0;
+}
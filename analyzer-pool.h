@@ -0,0 +1,36 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "files-list.h"
+#include "work-deque.h"
+
+#define ANALYZER_TASK_ENTRIES 64 // entries analyzed by a task
+
+typedef struct _analyzer_pool analyzer_pool_t;
+
+typedef struct {
+    work_deque_t deque; // tasks of this thread, stolen by the others when it is busy
+    analyzer_pool_t *pool;
+    int id;
+    pthread_t thread;
+} analyzer_thread_t;
+
+struct _analyzer_pool {
+    analyzer_thread_t *threads;
+    int threads_count;
+    int next_thread; // round robin of the submitted tasks
+    atomic_size_t pending; // tasks queued or being analyzed
+    atomic_size_t available; // tasks queued
+    atomic_int errors;
+    bool stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond; // new tasks, or stop
+    pthread_cond_t done_cond; // no more pending tasks
+};
+
+int init_analyzer_pool(analyzer_pool_t *pool, int threads_count);
+int submit_files_list(analyzer_pool_t *pool, files_list_t *list);
+int wait_analyzer_pool(analyzer_pool_t *pool);
+void clear_analyzer_pool(analyzer_pool_t *pool);
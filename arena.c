@@ -0,0 +1,182 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Allocation par blocs (arena) : les petites allocations sont prises à la suite les unes des autres
+// dans de gros blocs, et tout est libéré d'un coup
+
+/*!
+ * @brief init_arena initializes an empty arena
+ * @param arena is a pointer to the arena to initialize
+ * @param chunk_size is the size of the chunks to allocate (0 for the default size)
+ */
+void init_arena(arena_t *arena, size_t chunk_size) {
+    arena->chunks = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : ARENA_DEFAULT_CHUNK_SIZE;
+    arena->region = NULL;
+    arena->allocations_count = 0;
+    arena->allocated_bytes = 0;
+    arena->reserved_bytes = 0;
+    arena->peak_reserved_bytes = 0;
+}
+
+/*!
+ * @brief init_shared_arena initializes an empty arena whose chunks are taken from a shared region
+ * Its allocations are then visible at the same address by all the processes sharing the region.
+ * @param arena is a pointer to the arena to initialize
+ * @param chunk_size is the size of the chunks to allocate (0 for the default size)
+ * @param region is the shared region (NULL for a private arena, @see init_arena)
+ */
+void init_shared_arena(arena_t *arena, size_t chunk_size, shared_region_t *region) {
+    init_arena(arena, chunk_size);
+    arena->region = region;
+}
+
+/*!
+ * @brief arena_reserve reserves memory in the current chunk of the arena, adding a chunk if needed
+ * @param arena is a pointer to the arena
+ * @param size is the number of bytes to reserve
+ * @param alignment is the required alignment (a power of 2)
+ * @return a pointer to the reserved memory, NULL if out of memory
+ */
+static void *arena_reserve(arena_t *arena, size_t size, size_t alignment) {
+    if (arena->chunk_size == 0) {           //arena remise à zéro avec memset
+        arena->chunk_size = ARENA_DEFAULT_CHUNK_SIZE;
+    }
+
+    arena_chunk_t *chunk = arena->chunks;
+    if (chunk) {
+        size_t offset = (chunk->used + alignment - 1) & ~(alignment - 1);
+        if (offset + size <= chunk->size) {         //il reste de la place dans le bloc courant
+            chunk->used = offset + size;
+            arena->allocations_count++;
+            arena->allocated_bytes += size;
+            return (char *)chunk->data + offset;
+        }
+    }
+
+    size_t chunk_size = (size > arena->chunk_size) ? size : arena->chunk_size;
+    arena_chunk_t *new_chunk;
+    if (arena->region) {                    //bloc pris dans la mémoire partagée
+        new_chunk = shared_region_alloc(arena->region, sizeof(arena_chunk_t) + chunk_size, _Alignof(max_align_t));
+    } else {
+        new_chunk = malloc(sizeof(arena_chunk_t) + chunk_size);
+    }
+    if (!new_chunk) {
+        printf("out of memory\n");
+        return NULL;
+    }
+    new_chunk->shared = arena->region != NULL;
+    new_chunk->size = chunk_size;
+    new_chunk->used = size;
+
+    arena->allocations_count++;
+    arena->allocated_bytes += size;
+    arena->reserved_bytes += sizeof(arena_chunk_t) + chunk_size;
+    if (arena->reserved_bytes > arena->peak_reserved_bytes) {
+        arena->peak_reserved_bytes = arena->reserved_bytes;
+    }
+
+    if (chunk && size > arena->chunk_size) {        //bloc dédié : on garde le bloc courant en tête
+        new_chunk->next = chunk->next;
+        chunk->next = new_chunk;
+    } else {
+        new_chunk->next = chunk;
+        arena->chunks = new_chunk;
+    }
+
+    return new_chunk->data;
+}
+
+/*!
+ * @brief arena_alloc allocates memory from an arena, aligned for any type
+ * @param arena is a pointer to the arena
+ * @param size is the number of bytes to allocate
+ * @return a pointer to the allocated memory, NULL if out of memory
+ * The memory is only released by clear_arena
+ */
+void *arena_alloc(arena_t *arena, size_t size) {
+    if (!arena) {
+        return NULL;
+    }
+    return arena_reserve(arena, size, _Alignof(max_align_t));
+}
+
+/*!
+ * @brief arena_strndup copies a string into an arena
+ * @param arena is a pointer to the arena
+ * @param str is the string to copy
+ * @param length is the length of str (without the final \0)
+ * @return a pointer to the copy, NULL if out of memory
+ */
+char *arena_strndup(arena_t *arena, const char *str, size_t length) {
+    if (!arena || !str) {
+        return NULL;
+    }
+
+    char *copy = arena_reserve(arena, length + 1, 1);       //pas d'alignement pour les chaines
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+/*!
+ * @brief arena_adopt moves all the chunks of an arena into another one
+ * Memory allocated from other stays valid and is then released with arena. other is left empty.
+ * @param arena is a pointer to the arena receiving the chunks
+ * @param other is a pointer to the arena giving its chunks
+ */
+void arena_adopt(arena_t *arena, arena_t *other) {
+    if (!arena || !other || !other->chunks) {
+        return;
+    }
+
+    arena_chunk_t *last = other->chunks;
+    while (last->next) {
+        last = last->next;
+    }
+
+    if (arena->chunks) {            //le bloc courant de arena reste en tête
+        last->next = arena->chunks->next;
+        arena->chunks->next = other->chunks;
+    } else {
+        last->next = NULL;
+        arena->chunks = other->chunks;
+    }
+
+    arena->allocations_count += other->allocations_count;
+    arena->allocated_bytes += other->allocated_bytes;
+    arena->reserved_bytes += other->reserved_bytes;
+    if (arena->reserved_bytes > arena->peak_reserved_bytes) {
+        arena->peak_reserved_bytes = arena->reserved_bytes;
+    }
+
+    other->chunks = NULL;
+    other->allocations_count = 0;
+    other->allocated_bytes = 0;
+    other->reserved_bytes = 0;
+}
+
+/*!
+ * @brief clear_arena releases all the memory of an arena at once
+ * @param arena is a pointer to the arena to clear
+ */
+void clear_arena(arena_t *arena) {
+    if (!arena) {
+        return;
+    }
+    while (arena->chunks) {
+        arena_chunk_t *tmp = arena->chunks;
+        arena->chunks = tmp->next;
+        if (!tmp->shared) {                 //la mémoire partagée est libérée avec sa zone
+            free(tmp);
+        }
+    }
+    arena->allocations_count = 0;           //le pic est conservé
+    arena->allocated_bytes = 0;
+    arena->reserved_bytes = 0;
+}
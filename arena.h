@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "shared-region.h"
+
+#define ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+typedef struct _arena_chunk {
+    struct _arena_chunk *next;
+    size_t size; // usable bytes in data
+    size_t used;
+    bool shared; // taken from a shared region: never freed
+    max_align_t data[];
+} arena_chunk_t;
+
+typedef struct {
+    arena_chunk_t *chunks; // the current chunk is the head
+    size_t chunk_size;
+    shared_region_t *region; // where the chunks are taken from, NULL for malloc
+    // Counters
+    size_t allocations_count;
+    size_t allocated_bytes; // bytes given to the callers
+    size_t reserved_bytes; // bytes malloc'ed for the chunks
+    size_t peak_reserved_bytes;
+} arena_t;
+
+void init_arena(arena_t *arena, size_t chunk_size);
+void init_shared_arena(arena_t *arena, size_t chunk_size, shared_region_t *region);
+void *arena_alloc(arena_t *arena, size_t size);
+char *arena_strndup(arena_t *arena, const char *str, size_t length);
+void arena_adopt(arena_t *arena, arena_t *other);
+void clear_arena(arena_t *arena);
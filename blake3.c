@@ -0,0 +1,418 @@
+#include "blake3.h"
+#include <string.h>
+
+// BLAKE3 en mode hachage (sans clé), implémentation portable d'après la spécification :
+// morceaux de 1024 octets compressés par blocs de 64, puis arbre binaire des valeurs de chaînage
+// construit au fil de l'eau avec une pile. Seul le premier bloc de sortie est produit (32 octets maximum).
+// Avec AVX2 ou AVX-512, les morceaux complets sont compressés par 8 ou 16, un morceau par voie des
+// registres vectoriels (choix fait à l'exécution) ; les parents et le dernier morceau restent scalaires.
+
+#define CHUNK_START (1 << 0)
+#define CHUNK_END (1 << 1)
+#define PARENT (1 << 2)
+#define ROOT (1 << 3)
+
+static const uint32_t blake3_iv[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+static const uint8_t message_schedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+static inline uint32_t rotr32(uint32_t x, int r) {
+    return (x >> r) | (x << (32 - r));
+}
+
+static inline uint32_t load32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));           //x86 : petit-boutiste comme le format
+    return value;
+}
+
+static inline void g(uint32_t *state, int a, int b, int c, int d, uint32_t x, uint32_t y) {
+    state[a] = state[a] + state[b] + x;
+    state[d] = rotr32(state[d] ^ state[a], 16);
+    state[c] = state[c] + state[d];
+    state[b] = rotr32(state[b] ^ state[c], 12);
+    state[a] = state[a] + state[b] + y;
+    state[d] = rotr32(state[d] ^ state[a], 8);
+    state[c] = state[c] + state[d];
+    state[b] = rotr32(state[b] ^ state[c], 7);
+}
+
+/*!
+ * @brief compress runs the BLAKE3 compression function on a block
+ * @param cv is the input chaining value, replaced by the output chaining value
+ * @param block is the 64 bytes block
+ * @param block_length is the number of meaningful bytes in the block
+ * @param counter is the chunk counter (0 for parent nodes)
+ * @param flags are the domain flags of the block
+ */
+static void compress(uint32_t cv[8], const uint8_t block[BLAKE3_BLOCK_LENGTH], uint8_t block_length, uint64_t counter, uint8_t flags) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; ++i) {
+        m[i] = load32(block + 4 * i);
+    }
+
+    uint32_t state[16] = {
+        cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+        blake3_iv[0], blake3_iv[1], blake3_iv[2], blake3_iv[3],
+        (uint32_t)counter, (uint32_t)(counter >> 32), block_length, flags,
+    };
+
+    for (int round = 0; round < 7; ++round) {
+        const uint8_t *s = message_schedule[round];
+        g(state, 0, 4, 8, 12, m[s[0]], m[s[1]]);            //colonnes
+        g(state, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        g(state, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        g(state, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        g(state, 0, 5, 10, 15, m[s[8]], m[s[9]]);           //diagonales
+        g(state, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        g(state, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        g(state, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        cv[i] = state[i] ^ state[i + 8];
+    }
+}
+
+typedef uint32_t blake3_v8_t __attribute__((vector_size(32)));
+typedef uint32_t blake3_v16_t __attribute__((vector_size(64)));
+
+typedef void (*blake3_chunks_kernel_t)(const uint8_t *input, uint64_t counter, uint32_t cvs[][8]);
+
+/*
+ * Rotations d'un vecteur : AVX-512 a une instruction (vprord) ; avec AVX2, les rotations de 16 et 8 bits
+ * sont des permutations d'octets (vpshufb) au lieu de deux décalages et un ou.
+ */
+__attribute__((target("avx2"))) static inline blake3_v8_t rotr_v8(blake3_v8_t x, int r) {
+    typedef uint8_t bytes_t __attribute__((vector_size(32)));
+    if (r == 16) {
+        const bytes_t mask = {2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                              18, 19, 16, 17, 22, 23, 20, 21, 26, 27, 24, 25, 30, 31, 28, 29};
+        return (blake3_v8_t)__builtin_shuffle((bytes_t)x, mask);
+    }
+    if (r == 8) {
+        const bytes_t mask = {1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+                              17, 18, 19, 16, 21, 22, 23, 20, 25, 26, 27, 24, 29, 30, 31, 28};
+        return (blake3_v8_t)__builtin_shuffle((bytes_t)x, mask);
+    }
+    return (x >> r) | (x << (32 - r));
+}
+
+__attribute__((target("avx512f"))) static inline blake3_v16_t rotr_v16(blake3_v16_t x, int r) {
+    return (x >> r) | (x << (32 - r));
+}
+
+/*
+ * Même fonction g que ci-dessus, sur des vecteurs : une voie par morceau.
+ */
+#define BLAKE3_G(rotr, a, b, c, d, x, y)                                                        \
+    do {                                                                                        \
+        v[a] = v[a] + v[b] + (x);                                                               \
+        v[d] = rotr(v[d] ^ v[a], 16);                                                           \
+        v[c] = v[c] + v[d];                                                                     \
+        v[b] = rotr(v[b] ^ v[c], 12);                                                           \
+        v[a] = v[a] + v[b] + (y);                                                               \
+        v[d] = rotr(v[d] ^ v[a], 8);                                                            \
+        v[c] = v[c] + v[d];                                                                     \
+        v[b] = rotr(v[b] ^ v[c], 7);                                                            \
+    } while (0)
+
+/*
+ * Transposition d'une matrice carrée de width × width mots (une ligne par vecteur) en log2(width) étapes :
+ * l'étape s échange les blocs s × s hors de la diagonale, deux lignes à la fois, par des permutations
+ * à deux sources (vpermt2d) au lieu de width × width copies de mots.
+ */
+#define TRANSPOSE_MASK_LOW(width, s, e) (((e) & (s)) ? (width) + ((e) ^ (s)) : (e))
+#define TRANSPOSE_MASK_HIGH(width, s, e) (((e) & (s)) ? (width) + (e) : ((e) ^ (s)))
+#define LANES_8(f, width, s) f(width, s, 0), f(width, s, 1), f(width, s, 2), f(width, s, 3), \
+    f(width, s, 4), f(width, s, 5), f(width, s, 6), f(width, s, 7)
+#define LANES_16(f, width, s) LANES_8(f, width, s), f(width, s, 8), f(width, s, 9), f(width, s, 10), \
+    f(width, s, 11), f(width, s, 12), f(width, s, 13), f(width, s, 14), f(width, s, 15)
+
+#define TRANSPOSE_STAGE(type, lanes, width, rows, s)                                            \
+    do {                                                                                        \
+        const type mask_low = {lanes(TRANSPOSE_MASK_LOW, width, s)};                            \
+        const type mask_high = {lanes(TRANSPOSE_MASK_HIGH, width, s)};                          \
+        for (int i = 0; i < (width); ++i) {                                                     \
+            if (i & (s)) {                                                                      \
+                continue;                                                                       \
+            }                                                                                   \
+            type low = rows[i], high = rows[i + (s)];                                           \
+            rows[i] = __builtin_shuffle(low, high, mask_low);                                   \
+            rows[i + (s)] = __builtin_shuffle(low, high, mask_high);                            \
+        }                                                                                       \
+    } while (0)
+
+/*
+ * Avec AVX2, les permutations à deux sources quelconques n'existent pas : la transposition 8 × 8 utilise
+ * les entrelacements (vpunpckldq/vpunpcklqdq...) puis l'échange des moitiés de 128 bits (vperm2i128).
+ */
+__attribute__((target("avx2"))) static inline void transpose_v8(blake3_v8_t rows[8]) {
+    const blake3_v8_t low_32 = {0, 8, 1, 9, 4, 12, 5, 13}, high_32 = {2, 10, 3, 11, 6, 14, 7, 15};
+    const blake3_v8_t low_64 = {0, 1, 8, 9, 4, 5, 12, 13}, high_64 = {2, 3, 10, 11, 6, 7, 14, 15};
+    const blake3_v8_t low_128 = {0, 1, 2, 3, 8, 9, 10, 11}, high_128 = {4, 5, 6, 7, 12, 13, 14, 15};
+    blake3_v8_t pairs[8], quads[8];
+    for (int i = 0; i < 8; i += 2) {            //mots 32 bits de deux lignes entrelacés
+        pairs[i] = __builtin_shuffle(rows[i], rows[i + 1], low_32);
+        pairs[i + 1] = __builtin_shuffle(rows[i], rows[i + 1], high_32);
+    }
+    for (int i = 0; i < 8; i += 4) {            //puis les paires de 64 bits
+        quads[i] = __builtin_shuffle(pairs[i], pairs[i + 2], low_64);
+        quads[i + 1] = __builtin_shuffle(pairs[i], pairs[i + 2], high_64);
+        quads[i + 2] = __builtin_shuffle(pairs[i + 1], pairs[i + 3], low_64);
+        quads[i + 3] = __builtin_shuffle(pairs[i + 1], pairs[i + 3], high_64);
+    }
+    for (int i = 0; i < 4; ++i) {               //colonnes i et i + 4 : moitiés des lignes 0-3 et 4-7
+        rows[i] = __builtin_shuffle(quads[i], quads[i + 4], low_128);
+        rows[i + 4] = __builtin_shuffle(quads[i], quads[i + 4], high_128);
+    }
+}
+
+__attribute__((target("avx512f"))) static inline void transpose_v16(blake3_v16_t rows[16]) {
+    TRANSPOSE_STAGE(blake3_v16_t, LANES_16, 16, rows, 8);
+    TRANSPOSE_STAGE(blake3_v16_t, LANES_16, 16, rows, 4);
+    TRANSPOSE_STAGE(blake3_v16_t, LANES_16, 16, rows, 2);
+    TRANSPOSE_STAGE(blake3_v16_t, LANES_16, 16, rows, 1);
+}
+
+/*
+ * Compression de width morceaux complets et consécutifs, les 16 blocs de chacun à la suite. Les mots de
+ * chaque bloc sont transposés (mot j de chaque morceau dans le vecteur m[j]), par paquets de width mots.
+ */
+#define BLAKE3_CHUNKS_KERNEL(name, isa, type, width, transpose, rotr)                                            \
+    __attribute__((target(isa))) static void name(const uint8_t *input, uint64_t counter, uint32_t cvs[][8]) { \
+        typedef type vector_t;                                                                  \
+        vector_t zero = {0};                                                                    \
+        vector_t h[8];                                                                          \
+        for (int i = 0; i < 8; ++i) {                                                           \
+            h[i] = zero + blake3_iv[i];                                                         \
+        }                                                                                       \
+        uint32_t counters[2][width];                                                            \
+        for (int lane = 0; lane < width; ++lane) {                                              \
+            counters[0][lane] = (uint32_t)(counter + lane);                                     \
+            counters[1][lane] = (uint32_t)((counter + lane) >> 32);                             \
+        }                                                                                       \
+        vector_t counter_low, counter_high;                                                     \
+        memcpy(&counter_low, counters[0], sizeof(counter_low));                                 \
+        memcpy(&counter_high, counters[1], sizeof(counter_high));                               \
+                                                                                                \
+        for (int block = 0; block < BLAKE3_CHUNK_LENGTH / BLAKE3_BLOCK_LENGTH; ++block) {       \
+            vector_t m[16];                                                                     \
+            for (int part = 0; part < 16 / width; ++part) {                                     \
+                vector_t *rows = m + part * width;                                              \
+                for (int lane = 0; lane < width; ++lane) {                                      \
+                    memcpy(&rows[lane], input + lane * BLAKE3_CHUNK_LENGTH + block * BLAKE3_BLOCK_LENGTH \
+                           + part * sizeof(vector_t), sizeof(vector_t));                        \
+                }                                                                               \
+                transpose(rows);                                                                \
+            }                                                                                   \
+                                                                                                \
+            uint32_t flags = (block == 0 ? CHUNK_START : 0)                                     \
+                | (block == BLAKE3_CHUNK_LENGTH / BLAKE3_BLOCK_LENGTH - 1 ? CHUNK_END : 0);     \
+            vector_t v[16] = {                                                                  \
+                h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],                                 \
+                zero + blake3_iv[0], zero + blake3_iv[1], zero + blake3_iv[2], zero + blake3_iv[3], \
+                counter_low, counter_high, zero + BLAKE3_BLOCK_LENGTH, zero + flags,            \
+            };                                                                                  \
+            _Pragma("GCC unroll 7") for (int round = 0; round < 7; ++round) {                   \
+                const uint8_t *s = message_schedule[round];                                     \
+                BLAKE3_G(rotr, 0, 4, 8, 12, m[s[0]], m[s[1]]);                                  \
+                BLAKE3_G(rotr, 1, 5, 9, 13, m[s[2]], m[s[3]]);                                  \
+                BLAKE3_G(rotr, 2, 6, 10, 14, m[s[4]], m[s[5]]);                                 \
+                BLAKE3_G(rotr, 3, 7, 11, 15, m[s[6]], m[s[7]]);                                 \
+                BLAKE3_G(rotr, 0, 5, 10, 15, m[s[8]], m[s[9]]);                                 \
+                BLAKE3_G(rotr, 1, 6, 11, 12, m[s[10]], m[s[11]]);                               \
+                BLAKE3_G(rotr, 2, 7, 8, 13, m[s[12]], m[s[13]]);                                \
+                BLAKE3_G(rotr, 3, 4, 9, 14, m[s[14]], m[s[15]]);                                \
+            }                                                                                   \
+            for (int i = 0; i < 8; ++i) {                                                       \
+                h[i] = v[i] ^ v[i + 8];                                                         \
+            }                                                                                   \
+        }                                                                                       \
+                                                                                                \
+        uint32_t out[8][width];                                                                 \
+        memcpy(out, h, sizeof(out));                                                            \
+        for (int lane = 0; lane < width; ++lane) {                                              \
+            for (int i = 0; i < 8; ++i) {                                                       \
+                cvs[lane][i] = out[i][lane];                                                    \
+            }                                                                                   \
+        }                                                                                       \
+    }
+
+BLAKE3_CHUNKS_KERNEL(blake3_chunks_avx2, "avx2", blake3_v8_t, 8, transpose_v8, rotr_v8)
+BLAKE3_CHUNKS_KERNEL(blake3_chunks_avx512, "avx512f", blake3_v16_t, 16, transpose_v16, rotr_v16)
+
+/*!
+ * @brief blake3_lanes gives the number of chunks compressed at once on this CPU
+ * @return 16 with AVX-512, 8 with AVX2, 1 else (portable compression only)
+ */
+static int blake3_lanes(void) {
+    static int lanes = 0;
+    if (lanes == 0) {                           //détection faite une seule fois
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            lanes = 16;
+        } else if (__builtin_cpu_supports("avx2")) {
+            lanes = 8;
+        } else {
+            lanes = 1;
+        }
+    }
+    return lanes;
+}
+
+static void init_chunk_state(blake3_chunk_state_t *chunk, uint64_t chunk_counter) {
+    memcpy(chunk->cv, blake3_iv, sizeof(chunk->cv));
+    chunk->chunk_counter = chunk_counter;
+    memset(chunk->block, 0, sizeof(chunk->block));
+    chunk->block_length = 0;
+    chunk->blocks_compressed = 0;
+}
+
+static size_t chunk_state_length(const blake3_chunk_state_t *chunk) {
+    return (size_t)chunk->blocks_compressed * BLAKE3_BLOCK_LENGTH + chunk->block_length;
+}
+
+static uint8_t chunk_start_flag(const blake3_chunk_state_t *chunk) {
+    return chunk->blocks_compressed == 0 ? CHUNK_START : 0;
+}
+
+static void chunk_state_update(blake3_chunk_state_t *chunk, const uint8_t *input, size_t length) {
+    while (length > 0) {
+        if (chunk->block_length == BLAKE3_BLOCK_LENGTH) {       //le dernier bloc d'un morceau est compressé à la fin
+            compress(chunk->cv, chunk->block, BLAKE3_BLOCK_LENGTH, chunk->chunk_counter, chunk_start_flag(chunk));
+            chunk->blocks_compressed++;
+            memset(chunk->block, 0, sizeof(chunk->block));
+            chunk->block_length = 0;
+        }
+
+        size_t take = BLAKE3_BLOCK_LENGTH - chunk->block_length;
+        if (take > length) {
+            take = length;
+        }
+        memcpy(chunk->block + chunk->block_length, input, take);
+        chunk->block_length += (uint8_t)take;
+        input += take;
+        length -= take;
+    }
+}
+
+/*!
+ * @brief chunk_state_cv computes the chaining value of a chunk (or the root output when the chunk is the whole input)
+ */
+static void chunk_state_cv(const blake3_chunk_state_t *chunk, uint8_t extra_flags, uint32_t cv[8]) {
+    memcpy(cv, chunk->cv, 8 * sizeof(uint32_t));
+    compress(cv, chunk->block, chunk->block_length, chunk->chunk_counter, chunk_start_flag(chunk) | CHUNK_END | extra_flags);
+}
+
+static void parent_cv(const uint32_t left[8], const uint32_t right[8], uint8_t extra_flags, uint32_t cv[8]) {
+    uint8_t block[BLAKE3_BLOCK_LENGTH];
+    memcpy(block, left, 32);
+    memcpy(block + 32, right, 32);
+    memcpy(cv, blake3_iv, sizeof(blake3_iv));
+    compress(cv, block, BLAKE3_BLOCK_LENGTH, 0, PARENT | extra_flags);
+}
+
+/*!
+ * @brief push_chunk_cv adds the chaining value of a complete chunk to the tree, merging the complete subtrees
+ * @param hasher is a pointer to the hasher
+ * @param chunk_cv is the chaining value of the chunk
+ * @param chunk_counter is the index of the chunk
+ */
+static void push_chunk_cv(blake3_hasher_t *hasher, const uint32_t chunk_cv[8], uint64_t chunk_counter) {
+    uint32_t cv[8];
+    memcpy(cv, chunk_cv, sizeof(cv));
+    uint64_t total_chunks = chunk_counter + 1;
+    while ((total_chunks & 1) == 0) {           //fusion des sous-arbres complets
+        hasher->cv_stack_length--;
+        parent_cv(hasher->cv_stack[hasher->cv_stack_length], cv, 0, cv);
+        total_chunks >>= 1;
+    }
+    memcpy(hasher->cv_stack[hasher->cv_stack_length++], cv, sizeof(cv));
+}
+
+/*!
+ * @brief blake3_init initializes a BLAKE3 hasher
+ * @param hasher is a pointer to the hasher
+ */
+void blake3_init(blake3_hasher_t *hasher) {
+    init_chunk_state(&hasher->chunk, 0);
+    hasher->cv_stack_length = 0;
+}
+
+/*!
+ * @brief blake3_update feeds data into a BLAKE3 hasher
+ * @param hasher is a pointer to the hasher
+ * @param data is the data to hash
+ * @param length is the length of data
+ */
+void blake3_update(blake3_hasher_t *hasher, const void *data, size_t length) {
+    const uint8_t *input = data;
+    int lanes = blake3_lanes();
+    blake3_chunks_kernel_t kernel = (lanes == 16) ? blake3_chunks_avx512 : blake3_chunks_avx2;
+
+    while (length > 0) {
+        if (chunk_state_length(&hasher->chunk) == BLAKE3_CHUNK_LENGTH) {   //morceau complet et encore des données
+            uint32_t cv[8];
+            chunk_state_cv(&hasher->chunk, 0, cv);
+            push_chunk_cv(hasher, cv, hasher->chunk.chunk_counter);
+            init_chunk_state(&hasher->chunk, hasher->chunk.chunk_counter + 1);
+        }
+
+        //morceaux complets suivis d'autres données (aucun n'est la racine) : plusieurs à la fois
+        if (lanes > 1 && chunk_state_length(&hasher->chunk) == 0 && length > (size_t)lanes * BLAKE3_CHUNK_LENGTH) {
+            uint32_t cvs[16][8];
+            uint64_t counter = hasher->chunk.chunk_counter;
+            kernel(input, counter, cvs);
+            for (int i = 0; i < lanes; ++i) {
+                push_chunk_cv(hasher, cvs[i], counter + i);
+            }
+            init_chunk_state(&hasher->chunk, counter + lanes);
+            input += (size_t)lanes * BLAKE3_CHUNK_LENGTH;
+            length -= (size_t)lanes * BLAKE3_CHUNK_LENGTH;
+            continue;
+        }
+
+        size_t take = BLAKE3_CHUNK_LENGTH - chunk_state_length(&hasher->chunk);
+        if (take > length) {
+            take = length;
+        }
+        chunk_state_update(&hasher->chunk, input, take);
+        input += take;
+        length -= take;
+    }
+}
+
+/*!
+ * @brief blake3_final computes the digest of all the data fed into the hasher
+ * @param hasher is a pointer to the hasher (left unchanged)
+ * @param digest is the resulting digest
+ * @param digest_length is the length of the digest, up to 32 bytes
+ */
+void blake3_final(const blake3_hasher_t *hasher, uint8_t *digest, size_t digest_length) {
+    uint32_t cv[8];
+
+    if (hasher->cv_stack_length == 0) {         //un seul morceau : c'est la racine
+        chunk_state_cv(&hasher->chunk, ROOT, cv);
+    } else {
+        chunk_state_cv(&hasher->chunk, 0, cv);
+        for (int i = hasher->cv_stack_length - 1; i >= 0; --i) {
+            parent_cv(hasher->cv_stack[i], cv, i == 0 ? ROOT : 0, cv);
+        }
+    }
+
+    if (digest_length > 32) {
+        digest_length = 32;
+    }
+    memcpy(digest, cv, digest_length);          //x86 : mots déjà petit-boutistes
+}
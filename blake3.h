@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLAKE3_BLOCK_LENGTH 64
+#define BLAKE3_CHUNK_LENGTH 1024
+#define BLAKE3_MAX_DEPTH 54
+
+typedef struct {
+    uint32_t cv[8];
+    uint64_t chunk_counter;
+    uint8_t block[BLAKE3_BLOCK_LENGTH];
+    uint8_t block_length;
+    uint8_t blocks_compressed;
+} blake3_chunk_state_t;
+
+typedef struct {
+    blake3_chunk_state_t chunk;
+    uint32_t cv_stack[BLAKE3_MAX_DEPTH][8]; // chaining values of the complete subtrees
+    uint8_t cv_stack_length;
+} blake3_hasher_t;
+
+void blake3_init(blake3_hasher_t *hasher);
+void blake3_update(blake3_hasher_t *hasher, const void *data, size_t length);
+void blake3_final(const blake3_hasher_t *hasher, uint8_t *digest, size_t digest_length);
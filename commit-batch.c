@@ -0,0 +1,256 @@
+#define _GNU_SOURCE
+#include "commit-batch.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Remplacement atomique des fichiers de la destination : chaque fichier est écrit dans un fichier
+// temporaire du même dossier, puis renommé à sa place, de sorte qu'un arrêt brutal ne laisse jamais un
+// fichier tronqué. La durabilité est obtenue par lots : les données d'un lot sont écrites sur le disque
+// (syncfs ou fdatasync groupés) avant que ses fichiers ne soient renommés, au lieu d'un fsync par fichier.
+
+/*!
+ * @brief init_commit_batch prepares the batch of files to commit to a destination
+ * @param batch is a pointer to the batch
+ * @param mode is the durability mode
+ * @param interval is the number of files per batch
+ * @param destination is the destination directory
+ * @return 0 if all went good, -1 else
+ */
+int init_commit_batch(commit_batch_t *batch, durability_mode_t mode, size_t interval, char *destination) {
+    memset(batch, 0, sizeof(commit_batch_t));
+    batch->mode = mode;
+    batch->interval = interval ? interval : COMMIT_DEFAULT_INTERVAL;
+    batch->root_fd = -1;
+    pthread_mutex_init(&batch->lock, NULL);
+
+    if (mode == DURABILITY_NONE) {
+        return 0;
+    }
+    batch->pending = malloc(batch->interval * sizeof(pending_commit_t));
+    batch->root_fd = open(destination, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (!batch->pending || batch->root_fd == -1) {
+        printf("Erreur lors de la préparation des écritures dans %s\n", destination);
+        clear_commit_batch(batch);
+        return -1;
+    }
+    return 0;
+}
+
+/*!
+ * @brief create_commit_tmp creates a new temporary file next to a destination file
+ * Its name is unique (mkostemp), so that no existing file, nor the temporary file of a pending commit,
+ * is ever truncated.
+ * @param final_path is the path of the destination file
+ * @param mode is the access mode of the file
+ * @param tmp_path receives the path of the temporary file
+ * @param size is the size of tmp_path
+ * @return the file descriptor opened for writing, -1 in case of error
+ */
+int create_commit_tmp(char *final_path, mode_t mode, char *tmp_path, size_t size) {
+    if (snprintf(tmp_path, size, "%s%sXXXXXX", final_path, COMMIT_TMP_SUFFIX) >= (int)size) {
+        return -1;
+    }
+    int fd = mkostemp(tmp_path, O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    if (fchmod(fd, mode & 07777) == -1) {          //mkostemp crée en 0600
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+    return fd;
+}
+
+/*!
+ * @brief is_commit_tmp tells if a path names a temporary file of a commit (@see create_commit_tmp)
+ * Such files are only left behind by an interrupted run: they are never synchronized, and removed from the destination.
+ * @param path is the path to check
+ * @return true if the name matches, false else
+ */
+bool is_commit_tmp(const char *path) {
+    size_t length = strlen(path);
+    size_t suffix_length = sizeof(COMMIT_TMP_SUFFIX) - 1;
+    if (length < suffix_length + 6) {
+        return false;
+    }
+    const char *suffix = path + length - suffix_length - 6;
+    return memcmp(suffix, COMMIT_TMP_SUFFIX, suffix_length) == 0 && !memchr(suffix + suffix_length, '/', 6);
+}
+
+/*!
+ * @brief sync_file_data flushes the data of a written file
+ * @return 0 if all went good, -1 else
+ */
+static int sync_file_data(char *path, bool directory) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC | (directory ? O_DIRECTORY : 0));
+    if (fd == -1) {
+        return -1;
+    }
+    int result = directory ? fsync(fd) : fdatasync(fd);
+    close(fd);
+    return result;
+}
+
+/*!
+ * @brief discard_commit removes the temporary file of a commit that could not be made durable
+ * The destination file keeps its previous content.
+ */
+static void discard_commit(pending_commit_t *commit) {
+    printf("Erreur lors de l'écriture durable de %s, destination conservée\n", commit->final_path);
+    unlink(commit->tmp_path);
+}
+
+/*!
+ * @brief flush_pending makes the given files durable, then renames the ones whose data reached the disk
+ * It runs without the batch lock, so that copying threads keep committing during the flush.
+ * With syncfs, a failure leaves nothing known durable and no file is renamed; with fdatasync, only the
+ * files which failed are discarded. Discarded temporary files are unlinked and reported.
+ * @param batch is a pointer to the batch (only its mode and root_fd are used)
+ * @param pending is the array of files to commit, its entries are freed
+ * @param count is the number of files
+ * @return 0 if all went good, -1 else
+ */
+static int flush_pending(commit_batch_t *batch, pending_commit_t *pending, size_t count) {
+    int result = 0;
+    bool all_synced = true;
+    if (batch->mode == DURABILITY_SYNCFS && syncfs(batch->root_fd) == -1) {     //toutes les données du système de fichiers d'un coup
+        all_synced = false;
+        result = -1;
+    }
+
+    char *last_directory = NULL;
+    for (size_t i = 0; i < count; ++i) {
+        pending_commit_t *commit = &pending[i];
+        bool synced = all_synced;
+        if (synced && batch->mode == DURABILITY_FDATASYNC) {
+            synced = sync_file_data(commit->tmp_path, false) == 0;
+        }
+        if (!synced) {                              //données non durables : pas de renommage
+            discard_commit(commit);
+            result = -1;
+        } else if (rename(commit->tmp_path, commit->final_path) == -1) {   //données sur le disque : renommage
+            printf("Erreur lors du renommage de %s\n", commit->tmp_path);
+            unlink(commit->tmp_path);
+            result = -1;
+        } else if (batch->mode == DURABILITY_FDATASYNC) {     //renommage durable : fsync du dossier
+            char *slash = strrchr(commit->final_path, '/');
+            if (slash) {
+                *slash = '\0';
+                if (!last_directory || strcmp(last_directory, commit->final_path) != 0) {     //une fois par dossier
+                    sync_file_data(commit->final_path, true);
+                    free(last_directory);
+                    last_directory = strdup(commit->final_path);
+                }
+                *slash = '/';
+            }
+        }
+        free(commit->tmp_path);
+        free(commit->final_path);
+    }
+    free(last_directory);
+    return result;
+}
+
+/*!
+ * @brief commit_file replaces a destination file by its written temporary file
+ * Without durability, the file is renamed at once; else it is renamed when its batch is flushed.
+ * @param batch is a pointer to the batch
+ * @param tmp_path is the path of the written temporary file
+ * @param final_path is the path of the destination file
+ * @return 0 if all went good, -1 else
+ */
+int commit_file(commit_batch_t *batch, char *tmp_path, char *final_path) {
+    if (batch->mode == DURABILITY_NONE) {
+        if (rename(tmp_path, final_path) == -1) {
+            printf("Erreur lors du renommage de %s\n", tmp_path);
+            unlink(tmp_path);
+            return -1;
+        }
+        return 0;
+    }
+
+    char *tmp_copy = strdup(tmp_path);
+    char *final_copy = strdup(final_path);
+    if (!tmp_copy || !final_copy) {
+        printf("out of memory\n");
+        free(tmp_copy);
+        free(final_copy);
+        return -1;
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    batch->pending[batch->count].tmp_path = tmp_copy;
+    batch->pending[batch->count].final_path = final_copy;
+    batch->count++;
+    if (batch->count < batch->interval) {
+        pthread_mutex_unlock(&batch->lock);
+        return 0;
+    }
+
+    //lot complet : il est détaché et écrit hors du verrou, les autres threads en commencent un nouveau
+    pending_commit_t *full = batch->pending;
+    size_t full_count = batch->count;
+    pending_commit_t *fresh = malloc(batch->interval * sizeof(pending_commit_t));
+    int result;
+    batch->flushes++;
+    if (fresh) {
+        batch->pending = fresh;
+        batch->count = 0;
+        pthread_mutex_unlock(&batch->lock);
+        result = flush_pending(batch, full, full_count);
+        free(full);
+    } else {                                        //pas de nouveau tableau : écriture sous le verrou
+        result = flush_pending(batch, full, full_count);
+        batch->count = 0;
+        pthread_mutex_unlock(&batch->lock);
+    }
+    return result;
+}
+
+/*!
+ * @brief flush_commit_batch flushes the last files, then makes all the renames durable
+ * It must be called once every commit_file call has returned.
+ * @param batch is a pointer to the batch
+ * @return 0 if all went good, -1 else
+ */
+int flush_commit_batch(commit_batch_t *batch) {
+    if (batch->mode == DURABILITY_NONE) {
+        return 0;
+    }
+    pthread_mutex_lock(&batch->lock);
+    int result = 0;
+    if (batch->count > 0) {
+        result = flush_pending(batch, batch->pending, batch->count);
+        batch->count = 0;
+        batch->flushes++;
+    }
+    if (batch->mode == DURABILITY_SYNCFS && batch->flushes > 0 && syncfs(batch->root_fd) == -1) {     //renommages du dernier lot
+        result = -1;
+    }
+    pthread_mutex_unlock(&batch->lock);
+    return result;
+}
+
+/*!
+ * @brief clear_commit_batch releases a batch (pending files are left as temporary files)
+ * @param batch is a pointer to the batch
+ */
+void clear_commit_batch(commit_batch_t *batch) {
+    for (size_t i = 0; i < batch->count; ++i) {
+        free(batch->pending[i].tmp_path);
+        free(batch->pending[i].final_path);
+    }
+    free(batch->pending);
+    batch->pending = NULL;
+    batch->count = 0;
+    if (batch->root_fd != -1) {
+        close(batch->root_fd);
+        batch->root_fd = -1;
+    }
+    pthread_mutex_destroy(&batch->lock);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#define COMMIT_TMP_SUFFIX ".lp25-tmp." // followed by 6 random characters
+#define COMMIT_DEFAULT_INTERVAL 1000 // files per durability batch
+#define COMMIT_MAX_INTERVAL 1000000 // the pending array of a batch stays allocatable
+
+typedef enum {
+    DURABILITY_NONE, // renamed at once, flushed by the kernel writeback
+    DURABILITY_SYNCFS, // one syncfs of the destination per batch
+    DURABILITY_FDATASYNC, // fdatasync of each file of the batch, then fsync of their directories
+} durability_mode_t;
+
+typedef struct {
+    char *tmp_path;
+    char *final_path;
+} pending_commit_t;
+
+typedef struct {
+    durability_mode_t mode;
+    size_t interval;
+    int root_fd; // destination directory, for syncfs
+    pending_commit_t *pending; // written files waiting for the flush of their batch
+    size_t count;
+    size_t flushes;
+    pthread_mutex_t lock; // commits can come from several copying threads
+} commit_batch_t;
+
+int init_commit_batch(commit_batch_t *batch, durability_mode_t mode, size_t interval, char *destination);
+int create_commit_tmp(char *final_path, mode_t mode, char *tmp_path, size_t size);
+bool is_commit_tmp(const char *path);
+int commit_file(commit_batch_t *batch, char *tmp_path, char *final_path);
+int flush_commit_batch(commit_batch_t *batch);
+void clear_commit_batch(commit_batch_t *batch);
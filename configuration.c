@@ -1,11 +1,14 @@
 #include "configuration.h"
+#include "processes.h"
 #include <stddef.h>
 #include <stdlib.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
 
-typedef enum {DATE_SIZE_ONLY, NO_PARALLEL, DRY_RUN} long_opt_values; //JE RAJOUTE DRY-RUN
+typedef enum {DATE_SIZE_ONLY, NO_PARALLEL, DRY_RUN, WALKER_THREADS, HASH_CACHE, DIGEST, TREE_HASH, COMPARE, DELTA, COPY_THREADS, DURABILITY, SYNC_INTERVAL, TRANSPORT, PARALLEL_MODE} long_opt_values; //JE RAJOUTE DRY-RUN
 
 /*!
  * @brief function display_help displays a brief manual for the program usage
@@ -18,11 +21,55 @@ void display_help(char *my_name) {
     printf("         \t-h display help (this text)\n");
     printf("         \t--date_size_only disables MD5 calculation for files\n");
     printf("         \t--no-parallel disables parallel computing (cancels values of option -n)\n");
+    printf("         \t--walker-threads <threads count> number of threads listing each tree (default 1)\n");
+    printf("         \t--hash-cache <file> file of the MD5 cache (default: .lp25-hash-cache in the destination)\n");
+    printf("         \t--digest <md5|xxh3|blake3> function of the files digests (default md5)\n");
+    printf("         \t--tree-hash <threads count> hashes very large files by chunks on several threads\n");
+    printf("         \t--compare <hash|bytes|sampled> compares the contents by digests (default) or directly\n");
+    printf("         \t--copy-threads <threads count> number of threads copying the files (default 1)\n");
+    printf("         \t--delta updates large modified files by writing only their changed blocks\n");
+    printf("         \t--durability <none|syncfs|fdatasync> flushes copied files by batches before renaming them (default none)\n");
+    printf("         \t--sync-interval <files count> number of files per durability batch (default 1000)\n");
+    printf("         \t--parallel-mode <processes|threads> analyzers in child processes (default) or in threads of the main process\n");
+    printf("         \t--transport <ring|mq> messages between the processes: shared memory rings (default) or System V queue\n");
      printf("        \t--dry-run pour exécution de test (juste lister les opérations à faire, ne pas faire les copies réellement)\n"); //ajout de dry run ici
 }
 
 
 
+/*!
+ * @brief parse_count reads a positive count option
+ * @param value is the text of the option
+ * @param max is the largest accepted value
+ * @param count is a pointer to the parsed value
+ * @return 0 if the value is a number from 1 to max, -1 else (count is left unchanged)
+ */
+static int parse_count(const char *value, long max, long *count) {
+    char *end;
+    errno = 0;
+    long parsed = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || errno == ERANGE || parsed < 1 || parsed > max) {
+        return -1;
+    }
+    *count = parsed;
+    return 0;
+}
+
+/*!
+ * @brief parse_threads_count reads a threads count option, within the range of its uint8_t field
+ * @param value is the text of the option
+ * @param count is a pointer to the field to set
+ * @return 0 if the value is a number from 1 to 255, -1 else (the field is left unchanged)
+ */
+static int parse_threads_count(const char *value, uint8_t *count) {
+    long parsed;
+    if (parse_count(value, UINT8_MAX, &parsed) == -1) {
+        return -1;
+    }
+    *count = (uint8_t)parsed;
+    return 0;
+}
+
 /*!
  * @brief init_configuration initializes the configuration with default values
  * @param the_config is a pointer to the configuration to be initialized
@@ -32,13 +79,24 @@ void init_configuration(configuration_t *the_config) {
 
     the_config->source[0] = '\0';
     the_config->destination[0] = '\0';  //on initialiser la source et la destination a une chaine vide de base
+    the_config->hash_cache[0] = '\0';   //cache d'empreintes dans la destination par défaut
 
     the_config->processes_count = 1;   //on initialise à 1 processus 
+    the_config->walker_threads = 1;    //parcours des dossiers par un seul thread
+    the_config->copy_threads = 1;      //copies l'une après l'autre
+    the_config->tree_hash_threads = 0; //gros fichiers hachés d'un bloc
     the_config->is_parallel = true;   // de base on calcul en parallèle 
+    the_config->parallel_mode = PARALLEL_PROCESSES;
+    the_config->transport = TRANSPORT_RING;
     the_config->uses_md5 = true;       //de base on annalyse le md5
+    the_config->digest_algorithm = DIGEST_MD5;
+    the_config->compare_mode = COMPARE_HASH;
 
     the_config->verbose = false;
     the_config->dry_run = false;
+    the_config->delta = false;
+    the_config->durability = DURABILITY_NONE;
+    the_config->sync_interval = COMMIT_DEFAULT_INTERVAL;
 }
 
 /*!
@@ -56,6 +114,17 @@ int set_configuration(configuration_t *the_config, int argc, char *argv[]) {
         {.name="date-size-only", .has_arg=0, .flag=0, .val= DATE_SIZE_ONLY},
         {.name="no-parallel", .has_arg=0, .flag=0, .val= NO_PARALLEL},
         {.name="dry-run", .has_arg=0, .flag=0, .val= DRY_RUN},
+        {.name="walker-threads", .has_arg=1, .flag=0, .val= WALKER_THREADS},
+        {.name="hash-cache", .has_arg=1, .flag=0, .val= HASH_CACHE},
+        {.name="digest", .has_arg=1, .flag=0, .val= DIGEST},
+        {.name="tree-hash", .has_arg=1, .flag=0, .val= TREE_HASH},
+        {.name="compare", .has_arg=1, .flag=0, .val= COMPARE},
+        {.name="delta", .has_arg=0, .flag=0, .val= DELTA},
+        {.name="copy-threads", .has_arg=1, .flag=0, .val= COPY_THREADS},
+        {.name="durability", .has_arg=1, .flag=0, .val= DURABILITY},
+        {.name="sync-interval", .has_arg=1, .flag=0, .val= SYNC_INTERVAL},
+        {.name="transport", .has_arg=1, .flag=0, .val= TRANSPORT},
+        {.name="parallel-mode", .has_arg=1, .flag=0, .val= PARALLEL_MODE},
         {0, 0, 0, 0}
     };
 
@@ -63,8 +132,16 @@ int set_configuration(configuration_t *the_config, int argc, char *argv[]) {
     while ((opt = getopt_long(argc, argv, "n:vh", long_options, NULL)) != -1){ 
         switch (opt) {
             case 'n':
-                the_config->processes_count = atoi(optarg);
+            {
+                long count;
+                if (parse_count(optarg, MAX_ANALYZERS_PER_LIST, &count) == -1) {
+                    printf("Invalid processes count %s (1 to %d)\n", optarg, MAX_ANALYZERS_PER_LIST);
+                    display_help(argv[0]);
+                    return -1;
+                }
+                the_config->processes_count = (uint8_t)count;
                 break;
+            }
             case 'v':
                 the_config->verbose = true;
                 break;
@@ -77,6 +154,96 @@ int set_configuration(configuration_t *the_config, int argc, char *argv[]) {
             case DRY_RUN:
                 the_config->dry_run = true;
                 break;
+            case WALKER_THREADS:
+                if (parse_threads_count(optarg, &the_config->walker_threads) == -1) {
+                    printf("Invalid walker threads count %s (1 to %d)\n", optarg, UINT8_MAX);
+                    display_help(argv[0]);
+                    return -1;
+                }
+                break;
+            case HASH_CACHE:
+                strncpy(the_config->hash_cache, optarg, sizeof(the_config->hash_cache) - 1);
+                the_config->hash_cache[sizeof(the_config->hash_cache) - 1] = '\0';
+                break;
+            case DIGEST:
+                if (parse_digest_algorithm(optarg, &the_config->digest_algorithm) == -1) {
+                    printf("Unknown digest %s\n", optarg);
+                    display_help(argv[0]);
+                    return -1;
+                }
+                break;
+            case TREE_HASH:
+                if (parse_threads_count(optarg, &the_config->tree_hash_threads) == -1) {
+                    printf("Invalid tree hash threads count %s (1 to %d)\n", optarg, UINT8_MAX);
+                    display_help(argv[0]);
+                    return -1;
+                }
+                break;
+            case COMPARE:
+                if (strcmp(optarg, "hash") == 0) {
+                    the_config->compare_mode = COMPARE_HASH;
+                } else if (strcmp(optarg, "bytes") == 0) {
+                    the_config->compare_mode = COMPARE_BYTES;
+                } else if (strcmp(optarg, "sampled") == 0) {
+                    the_config->compare_mode = COMPARE_SAMPLED;
+                } else {
+                    printf("Unknown comparison %s\n", optarg);
+                    display_help(argv[0]);
+                    return -1;
+                }
+                break;
+            case DELTA:
+                the_config->delta = true;
+                break;
+            case COPY_THREADS:
+                if (parse_threads_count(optarg, &the_config->copy_threads) == -1) {
+                    printf("Invalid copy threads count %s (1 to %d)\n", optarg, UINT8_MAX);
+                    display_help(argv[0]);
+                    return -1;
+                }
+                break;
+            case DURABILITY:
+                if (strcmp(optarg, "none") == 0) {
+                    the_config->durability = DURABILITY_NONE;
+                } else if (strcmp(optarg, "syncfs") == 0) {
+                    the_config->durability = DURABILITY_SYNCFS;
+                } else if (strcmp(optarg, "fdatasync") == 0) {
+                    the_config->durability = DURABILITY_FDATASYNC;
+                } else {
+                    printf("Unknown durability %s\n", optarg);
+                    display_help(argv[0]);
+                    return -1;
+                }
+                break;
+            case SYNC_INTERVAL:
+            {
+                long interval;
+                if (parse_count(optarg, COMMIT_MAX_INTERVAL, &interval) == -1) {
+                    printf("Invalid sync interval %s (1 to %d)\n", optarg, COMMIT_MAX_INTERVAL);
+                    display_help(argv[0]);
+                    return -1;
+                }
+                the_config->sync_interval = interval;
+                break;
+            }
+            case TRANSPORT:
+                if (parse_transport_kind(optarg, &the_config->transport) == -1) {
+                    printf("Unknown transport %s\n", optarg);
+                    display_help(argv[0]);
+                    return -1;
+                }
+                break;
+            case PARALLEL_MODE:
+                if (strcmp(optarg, "processes") == 0) {
+                    the_config->parallel_mode = PARALLEL_PROCESSES;
+                } else if (strcmp(optarg, "threads") == 0) {
+                    the_config->parallel_mode = PARALLEL_THREADS;
+                } else {
+                    printf("Unknown parallel mode %s\n", optarg);
+                    display_help(argv[0]);
+                    return -1;
+                }
+                break;
             case 'h':
                 display_help(argv[0]);
                 return -1;
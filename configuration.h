@@ -2,16 +2,41 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "digest.h"
+#include "commit-batch.h"
+#include "transport.h"
+
+typedef enum {
+    COMPARE_HASH, // digests of both files
+    COMPARE_BYTES, // direct comparison of the contents
+    COMPARE_SAMPLED, // direct comparison, after a sampled prefilter
+} compare_mode_t;
+
+typedef enum {
+    PARALLEL_PROCESSES, // listers and analyzers are forked processes
+    PARALLEL_THREADS, // analyzers are threads of the main process
+} parallel_mode_t;
 
 typedef struct {
     char source[1024];
     char destination[1024];
+    char hash_cache[1024]; // path of the hash cache file, empty for the default one in the destination
     uint8_t processes_count;
+    uint8_t walker_threads;
+    uint8_t copy_threads; // threads copying the files
+    uint8_t tree_hash_threads; // threads hashing the chunks of very large files, 0 to hash them whole
     bool is_parallel;
+    parallel_mode_t parallel_mode; // when is_parallel is set
+    transport_kind_t transport; // messages between the processes, in PARALLEL_PROCESSES mode
     bool uses_md5;
+    digest_algorithm_t digest_algorithm; // function of the files digests when uses_md5 is set
+    compare_mode_t compare_mode; // how the contents are compared when uses_md5 is set
 
     bool verbose;
     bool dry_run;
+    bool delta; // large modified files: write only the changed blocks
+    durability_mode_t durability; // how copied files are made durable
+    size_t sync_interval; // files per durability batch
 
 } configuration_t;
 
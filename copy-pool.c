@@ -0,0 +1,110 @@
+#include "copy-pool.h"
+#include "sync.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// File de copies partagée par plusieurs threads. Les fichiers sont pris dans l'ordre de la liste, et
+// un fichier n'est commencé que si le nombre de fichiers et d'octets en cours de copie reste sous les
+// limites (un fichier plus gros que la limite d'octets est copié seul). Les dossiers doivent avoir été
+// créés avant.
+
+typedef struct {
+    files_list_entry_t **files;
+    size_t count;
+    size_t next; // next file to copy
+    size_t inflight_files;
+    uint64_t inflight_bytes;
+    configuration_t *the_config;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} copy_queue_t;
+
+/*!
+ * @brief take_file waits until the next file of the queue can be started within the limits
+ * @param queue is a pointer to the copy queue
+ * @return the file, NULL when the queue is empty
+ */
+static files_list_entry_t *take_file(copy_queue_t *queue) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->next < queue->count) {
+        files_list_entry_t *file = queue->files[queue->next];
+        bool fits = queue->inflight_files < COPY_MAX_INFLIGHT_FILES
+                    && (queue->inflight_bytes == 0 || queue->inflight_bytes + file->size <= COPY_MAX_INFLIGHT_BYTES);
+        if (fits) {
+            queue->next++;
+            queue->inflight_files++;
+            queue->inflight_bytes += file->size;
+            pthread_mutex_unlock(&queue->lock);
+            return file;
+        }
+        pthread_cond_wait(&queue->cond, &queue->lock);      //attente de la fin d'une copie
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+/*!
+ * @brief copy_worker copies files from the queue until it is empty
+ * @param parameters is a pointer to the copy_queue_t
+ */
+static void *copy_worker(void *parameters) {
+    copy_queue_t *queue = (copy_queue_t *)parameters;
+    files_list_entry_t *file;
+
+    while ((file = take_file(queue)) != NULL) {
+        copy_entry_to_destination(file, queue->the_config);
+
+        pthread_mutex_lock(&queue->lock);
+        queue->inflight_files--;
+        queue->inflight_bytes -= file->size;
+        pthread_cond_broadcast(&queue->cond);
+        pthread_mutex_unlock(&queue->lock);
+    }
+    return NULL;
+}
+
+/*!
+ * @brief copy_files_parallel copies files to the destination with several threads
+ * @param files are the source entries of the files to copy (their directories must exist)
+ * @param count is the number of files
+ * @param the_config is a pointer to the configuration
+ * @param threads_count is the number of copying threads (the calling thread is one of them)
+ * @return 0 if all went good, -1 else
+ */
+int copy_files_parallel(files_list_entry_t **files, size_t count, configuration_t *the_config, int threads_count) {
+    if (!files || !the_config) {
+        printf("Invalid parameters\n");
+        return -1;
+    }
+    if (threads_count < 1) {
+        threads_count = 1;
+    }
+
+    copy_queue_t queue;
+    queue.files = files;
+    queue.count = count;
+    queue.next = 0;
+    queue.inflight_files = 0;
+    queue.inflight_bytes = 0;
+    queue.the_config = the_config;
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.cond, NULL);
+
+    pthread_t threads[threads_count];
+    int started = 1;
+    for (; started < threads_count && (size_t)started < count; ++started) {
+        if (pthread_create(&threads[started], NULL, copy_worker, &queue) != 0) {
+            printf("Erreur lors de la création d'un thread\n");
+            break;
+        }
+    }
+    copy_worker(&queue);                        //le thread appelant copie aussi
+    for (int i = 1; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&queue.lock);
+    pthread_cond_destroy(&queue.cond);
+    return 0;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "files-list.h"
+#include "configuration.h"
+
+#define COPY_MAX_INFLIGHT_FILES 64
+#define COPY_MAX_INFLIGHT_BYTES (256ULL * 1024 * 1024) // a larger file is copied alone
+
+int copy_files_parallel(files_list_entry_t **files, size_t count, configuration_t *the_config, int threads_count);
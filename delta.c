@@ -0,0 +1,425 @@
+#define _GNU_SOURCE
+#include "delta.h"
+#include "xxh3.h"
+#include "commit-batch.h"
+#include "map-guard.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+// Transfert différentiel à la rsync entre deux fichiers locaux : l'ancienne destination est découpée en
+// blocs (somme faible glissante + empreinte forte XXH3-128), puis la source est parcourue octet par octet
+// à la recherche de ces blocs. Si chaque bloc retrouvé est à sa place d'origine, seuls les octets modifiés
+// sont écrits dans la destination ; sinon le fichier est reconstruit dans un fichier temporaire.
+
+#define DELTA_TAG_BITS 16
+
+typedef struct {
+    uint32_t weak;
+    uint32_t block;
+    uint8_t strong[16];
+} delta_signature_t;
+
+typedef struct {
+    uint64_t source_offset;
+    uint64_t length;
+    int64_t block; // block of the old destination, -1 for literal data from the source
+} delta_op_t;
+
+typedef struct {
+    delta_op_t *ops;
+    size_t count;
+    size_t capacity;
+} delta_ops_t;
+
+/*!
+ * @brief weak_checksum computes the rsync weak checksum of a block
+ * @param data is the block
+ * @param length is the length of the block
+ * @param a receives the sum of the bytes, b the sum of the partial sums (both modulo 2^16)
+ */
+static void weak_checksum(const uint8_t *data, size_t length, uint32_t *a, uint32_t *b) {
+    uint32_t s1 = 0, s2 = 0;
+    for (size_t i = 0; i < length; ++i) {
+        s1 += data[i];
+        s2 += (uint32_t)(length - i) * data[i];
+    }
+    *a = s1 & 0xffff;
+    *b = s2 & 0xffff;
+}
+
+static inline uint32_t weak_value(uint32_t a, uint32_t b) {
+    return a | (b << 16);
+}
+
+static inline uint32_t weak_tag(uint32_t weak) {
+    return (weak ^ (weak >> DELTA_TAG_BITS)) & ((1 << DELTA_TAG_BITS) - 1);
+}
+
+static void strong_hash(const uint8_t *data, size_t length, uint8_t digest[16]) {
+    xxh3_state_t state;
+    xxh3_128_init(&state);
+    xxh3_128_update(&state, data, length);
+    xxh3_128_final(&state, digest);
+}
+
+static int compare_signatures(const void *lhd, const void *rhd) {
+    const delta_signature_t *left = lhd;
+    const delta_signature_t *right = rhd;
+    uint32_t left_tag = weak_tag(left->weak), right_tag = weak_tag(right->weak);
+    if (left_tag != right_tag) {
+        return (left_tag < right_tag) ? -1 : 1;
+    }
+    if (left->weak != right->weak) {
+        return (left->weak < right->weak) ? -1 : 1;
+    }
+    return (left->block < right->block) ? -1 : (left->block > right->block);
+}
+
+/*!
+ * @brief add_op appends an operation, merging it with the previous one when they are contiguous
+ * @return 0 if all went good, -1 else (out of memory)
+ */
+static int add_op(delta_ops_t *ops, uint64_t source_offset, uint64_t length, int64_t block) {
+    if (length == 0) {
+        return 0;
+    }
+    if (ops->count > 0) {
+        delta_op_t *last = &ops->ops[ops->count - 1];
+        bool contiguous_literal = block == -1 && last->block == -1;
+        bool contiguous_blocks = block >= 0 && last->block >= 0
+                                 && (uint64_t)block * DELTA_BLOCK_SIZE == (uint64_t)last->block * DELTA_BLOCK_SIZE + last->length;
+        if (contiguous_literal || contiguous_blocks) {
+            last->length += length;
+            return 0;
+        }
+    }
+    if (ops->count == ops->capacity) {
+        size_t new_capacity = ops->capacity ? ops->capacity * 2 : 256;
+        delta_op_t *new_ops = realloc(ops->ops, new_capacity * sizeof(delta_op_t));
+        if (!new_ops) {
+            printf("out of memory\n");
+            return -1;
+        }
+        ops->ops = new_ops;
+        ops->capacity = new_capacity;
+    }
+    ops->ops[ops->count].source_offset = source_offset;
+    ops->ops[ops->count].length = length;
+    ops->ops[ops->count].block = block;
+    ops->count++;
+    return 0;
+}
+
+/*!
+ * @brief find_block looks for a block of the old destination equal to a window of the source
+ * @param signatures are the signatures sorted by (tag, weak, block)
+ * @param tag_start gives, for each tag, the index of its first signature (tag_start[tag + 1] is the end)
+ * @param weak is the weak checksum of the window
+ * @param window is the window of the source
+ * @param preferred is the block at the same offset as the window (chosen first, for in-place updates)
+ * @return the block found, -1 if none
+ */
+static int64_t find_block(delta_signature_t *signatures, uint32_t *tag_start, uint32_t weak, const uint8_t *window, int64_t preferred) {
+    uint32_t tag = weak_tag(weak);
+    if (tag_start[tag] == tag_start[tag + 1]) {         //cas le plus fréquent : rien à comparer
+        return -1;
+    }
+
+    uint8_t strong[16];
+    bool strong_computed = false;
+    int64_t found = -1;
+    for (uint32_t i = tag_start[tag]; i < tag_start[tag + 1]; ++i) {
+        if (signatures[i].weak != weak) {
+            continue;
+        }
+        if (!strong_computed) {
+            strong_hash(window, DELTA_BLOCK_SIZE, strong);
+            strong_computed = true;
+        }
+        if (memcmp(strong, signatures[i].strong, sizeof(strong)) == 0) {
+            found = signatures[i].block;
+            if (found == preferred) {
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+/*!
+ * @brief make_delta finds the blocks of the old destination in the source
+ * @param source is the mapped source
+ * @param source_size is the size of the source
+ * @param destination is the mapped old destination
+ * @param blocks_count is the number of full blocks in the old destination
+ * @param ops receives the operations rebuilding the source
+ * @return 0 if all went good, -1 else (out of memory, or a file truncated during the read: @see map_guard_enter)
+ */
+static int make_delta(const uint8_t *source, uint64_t source_size, const uint8_t *destination, uint64_t blocks_count, delta_ops_t *ops) {
+    delta_signature_t *signatures = malloc(blocks_count * sizeof(delta_signature_t));
+    uint32_t *tag_start = calloc((1 << DELTA_TAG_BITS) + 1, sizeof(uint32_t));
+    if (!signatures || !tag_start) {
+        printf("out of memory\n");
+        free(signatures);
+        free(tag_start);
+        return -1;
+    }
+
+    //seules ces lectures touchent les projections : les écritures en copient avec pwrite (EFAULT, pas SIGBUS)
+    map_guard_t guard;
+    if (sigsetjmp(guard.env, 1) != 0) {             //fichier tronqué pendant la lecture
+        printf("Fichier modifié pendant la copie différentielle\n");
+        free(signatures);
+        free(tag_start);
+        return -1;
+    }
+    if (map_guard_enter(&guard) == -1) {
+        free(signatures);
+        free(tag_start);
+        return -1;
+    }
+
+    for (uint64_t i = 0; i < blocks_count; ++i) {       //signatures de l'ancienne destination
+        uint32_t a, b;
+        weak_checksum(destination + i * DELTA_BLOCK_SIZE, DELTA_BLOCK_SIZE, &a, &b);
+        signatures[i].weak = weak_value(a, b);
+        signatures[i].block = i;
+        strong_hash(destination + i * DELTA_BLOCK_SIZE, DELTA_BLOCK_SIZE, signatures[i].strong);
+    }
+    qsort(signatures, blocks_count, sizeof(delta_signature_t), compare_signatures);
+    for (uint64_t i = 0; i < blocks_count; ++i) {
+        tag_start[weak_tag(signatures[i].weak) + 1]++;
+    }
+    for (uint32_t tag = 0; tag < (1 << DELTA_TAG_BITS); ++tag) {
+        tag_start[tag + 1] += tag_start[tag];
+    }
+
+    int result = 0;
+    uint64_t position = 0;
+    uint64_t literal_start = 0;
+    uint32_t a = 0, b = 0;
+    if (source_size >= DELTA_BLOCK_SIZE) {
+        weak_checksum(source, DELTA_BLOCK_SIZE, &a, &b);
+    }
+    while (result == 0 && position + DELTA_BLOCK_SIZE <= source_size) {
+        int64_t preferred = (position % DELTA_BLOCK_SIZE == 0) ? (int64_t)(position / DELTA_BLOCK_SIZE) : -1;
+        int64_t block = find_block(signatures, tag_start, weak_value(a, b), source + position, preferred);
+        if (block >= 0) {                       //bloc retrouvé : les octets en attente sont des données littérales
+            result = add_op(ops, literal_start, position - literal_start, -1);
+            if (result == 0) {
+                result = add_op(ops, position, DELTA_BLOCK_SIZE, block);
+            }
+            position += DELTA_BLOCK_SIZE;
+            literal_start = position;
+            if (position + DELTA_BLOCK_SIZE <= source_size) {
+                weak_checksum(source + position, DELTA_BLOCK_SIZE, &a, &b);
+            }
+            continue;
+        }
+
+        if (position + DELTA_BLOCK_SIZE == source_size) {
+            break;
+        }
+        uint8_t out = source[position];         //fenêtre glissante d'un octet
+        uint8_t in = source[position + DELTA_BLOCK_SIZE];
+        a = (a - out + in) & 0xffff;
+        b = (b - (uint32_t)DELTA_BLOCK_SIZE * out + a) & 0xffff;
+        position++;
+    }
+    if (result == 0) {
+        result = add_op(ops, literal_start, source_size - literal_start, -1);
+    }
+    map_guard_leave(&guard);
+
+    free(signatures);
+    free(tag_start);
+    return result;
+}
+
+/*!
+ * @brief write_range writes a range of a mapped file at an offset, looping on partial writes
+ * @return 0 if all went good, -1 else
+ */
+static int write_range(int fd, const uint8_t *data, uint64_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, offset);
+        if (written == -1 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return -1;
+        }
+        data += written;
+        offset += written;
+        length -= written;
+    }
+    return 0;
+}
+
+/*!
+ * @brief apply_in_place writes the literal data of the delta into the destination and sets its size
+ * Only valid when every block found is at its original offset.
+ */
+static int apply_in_place(char *destination_path, const uint8_t *source, uint64_t source_size, delta_ops_t *ops, delta_stats_t *stats) {
+    int fd = open(destination_path, O_WRONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    int result = 0;
+    for (size_t i = 0; result == 0 && i < ops->count; ++i) {
+        if (ops->ops[i].block == -1) {
+            result = write_range(fd, source + ops->ops[i].source_offset, ops->ops[i].length, ops->ops[i].source_offset);
+            stats->bytes_written += ops->ops[i].length;
+        }
+    }
+    if (result == 0 && ftruncate(fd, source_size) == -1) {
+        result = -1;
+    }
+    if (close(fd) == -1) {
+        result = -1;
+    }
+    return result;
+}
+
+/*!
+ * @brief apply_to_temporary rebuilds the source in a temporary file, then renames it over the destination
+ * Blocks found in the old destination are copied by the kernel (copy_file_range) when possible.
+ * With tmp_path, the file is not renamed: its path is returned so that the caller commits it.
+ */
+static int apply_to_temporary(char *destination_path, int destination_fd, const uint8_t *source, const uint8_t *destination, mode_t mode, delta_ops_t *ops, delta_stats_t *stats, char **tmp_path_out) {
+    size_t tmp_size = strlen(destination_path) + sizeof(COMMIT_TMP_SUFFIX) + 6;
+    char *tmp_path = malloc(tmp_size);
+    if (!tmp_path) {
+        printf("out of memory\n");
+        return -1;
+    }
+
+    int fd = create_commit_tmp(destination_path, mode, tmp_path, tmp_size);     //nom unique, nettoyé s'il est abandonné
+    if (fd == -1) {
+        free(tmp_path);
+        return -1;
+    }
+
+    int result = 0;
+    for (size_t i = 0; result == 0 && i < ops->count; ++i) {
+        delta_op_t *op = &ops->ops[i];
+        if (op->block == -1) {
+            result = write_range(fd, source + op->source_offset, op->length, op->source_offset);
+        } else {
+            loff_t in_offset = (loff_t)op->block * DELTA_BLOCK_SIZE;
+            loff_t out_offset = op->source_offset;
+            uint64_t remaining = op->length;
+            while (remaining > 0) {             //copie dans le noyau, sinon depuis la projection
+                ssize_t copied = copy_file_range(destination_fd, &in_offset, fd, &out_offset, remaining, 0);
+                if (copied <= 0) {
+                    result = write_range(fd, destination + in_offset, remaining, out_offset);
+                    break;
+                }
+                remaining -= copied;
+            }
+        }
+        stats->bytes_written += op->length;
+    }
+
+    if (close(fd) == -1) {
+        result = -1;
+    }
+    if (result == 0 && tmp_path_out) {          //renommé par l'appelant
+        *tmp_path_out = tmp_path;
+        return 0;
+    }
+    if (result == 0 && rename(tmp_path, destination_path) == -1) {
+        result = -1;
+    }
+    if (result == -1) {
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+    return result;
+}
+
+/*!
+ * @brief delta_copy_file updates an existing destination file to the content of the source, writing only what changed
+ * @param source_path is the path of the source file
+ * @param destination_path is the path of the existing destination file
+ * @param stats is a pointer to the statistics of the transfer
+ * @param tmp_path is a pointer receiving the allocated path of the rebuilt temporary file, left to the caller
+ * to rename (and free) instead of renaming it at once; the destination is then never written in place.
+ * NULL to replace the destination directly.
+ * @return 0 if all went good, 1 if the delta is not worth it (copy the file whole), -1 in case of error
+ */
+int delta_copy_file(char *source_path, char *destination_path, delta_stats_t *stats, char **tmp_path) {
+    memset(stats, 0, sizeof(delta_stats_t));
+    if (tmp_path) {
+        *tmp_path = NULL;
+    }
+
+    int source_fd = open(source_path, O_RDONLY | O_CLOEXEC);
+    if (source_fd == -1) {
+        return -1;
+    }
+    int destination_fd = open(destination_path, O_RDONLY | O_CLOEXEC);
+    if (destination_fd == -1) {
+        close(source_fd);
+        return 1;                               //pas d'ancienne version
+    }
+
+    struct stat source_stats, destination_stats;
+    if (fstat(source_fd, &source_stats) == -1 || fstat(destination_fd, &destination_stats) == -1
+        || !S_ISREG(destination_stats.st_mode) || destination_stats.st_size < DELTA_BLOCK_SIZE
+        || source_stats.st_size < DELTA_BLOCK_SIZE) {
+        close(source_fd);
+        close(destination_fd);
+        return 1;
+    }
+
+    uint64_t source_size = source_stats.st_size;
+    uint64_t destination_size = destination_stats.st_size;
+    uint8_t *source = mmap(NULL, source_size, PROT_READ, MAP_PRIVATE, source_fd, 0);
+    uint8_t *destination = mmap(NULL, destination_size, PROT_READ, MAP_PRIVATE, destination_fd, 0);
+    int result = 1;
+    if (source != MAP_FAILED && destination != MAP_FAILED) {
+        madvise(source, source_size, MADV_SEQUENTIAL);
+        madvise(destination, destination_size, MADV_SEQUENTIAL);
+
+        delta_ops_t ops = {NULL, 0, 0};
+        result = make_delta(source, source_size, destination, destination_size / DELTA_BLOCK_SIZE, &ops);
+        stats->bytes_read = source_size + destination_size;
+
+        if (result == 0) {
+            stats->in_place = !tmp_path;        //en place seulement si aucun bloc n'a bougé et sans renommage différé
+            for (size_t i = 0; i < ops.count; ++i) {
+                if (ops.ops[i].block >= 0) {
+                    stats->matched_bytes += ops.ops[i].length;
+                    if ((uint64_t)ops.ops[i].block * DELTA_BLOCK_SIZE != ops.ops[i].source_offset) {
+                        stats->in_place = false;
+                    }
+                }
+            }
+            if (stats->matched_bytes == 0) {
+                result = 1;                     //rien en commun : copie complète
+            } else if (stats->in_place) {
+                result = apply_in_place(destination_path, source, source_size, &ops, stats);
+            } else {
+                result = apply_to_temporary(destination_path, destination_fd, source, destination, source_stats.st_mode & 07777, &ops, stats, tmp_path);
+            }
+        }
+        free(ops.ops);
+    }
+
+    if (source != MAP_FAILED) {
+        munmap(source, source_size);
+    }
+    if (destination != MAP_FAILED) {
+        munmap(destination, destination_size);
+    }
+    close(source_fd);
+    close(destination_fd);
+    return result;
+}
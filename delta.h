@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DELTA_MIN_SIZE (16 * 1024 * 1024) // smaller files are copied whole
+#define DELTA_BLOCK_SIZE (64 * 1024)
+
+typedef struct {
+    uint64_t bytes_read; // from the source and the old destination
+    uint64_t bytes_written; // into the destination
+    uint64_t matched_bytes; // source bytes found in the old destination
+    bool in_place; // only the changed blocks were written, else a temporary file replaced the destination
+} delta_stats_t;
+
+int delta_copy_file(char *source_path, char *destination_path, delta_stats_t *stats, char **tmp_path);
@@ -0,0 +1,120 @@
+#include "digest.h"
+#include <string.h>
+
+// Choix de la fonction d'empreinte des fichiers : MD5 (libcrypto) par défaut, ou une fonction rapide
+// non cryptographique (XXH3-128) ou cryptographique (BLAKE3 tronqué à 128 bits).
+
+static const char *digest_names[] = {
+    [DIGEST_MD5] = "md5",
+    [DIGEST_XXH3] = "xxh3",
+    [DIGEST_BLAKE3] = "blake3",
+};
+
+/*!
+ * @brief parse_digest_algorithm finds a digest algorithm from its name
+ * @param name is the name of the algorithm (md5, xxh3 or blake3)
+ * @param algorithm is a pointer to the algorithm found
+ * @return 0 if the name is known, -1 else
+ */
+int parse_digest_algorithm(const char *name, digest_algorithm_t *algorithm) {
+    for (size_t i = 0; i < sizeof(digest_names) / sizeof(digest_names[0]); ++i) {
+        if (strcmp(name, digest_names[i]) == 0) {
+            *algorithm = (digest_algorithm_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*!
+ * @brief digest_algorithm_name gives the name of a digest algorithm
+ * @param algorithm is the algorithm
+ * @return the name of the algorithm
+ */
+const char *digest_algorithm_name(digest_algorithm_t algorithm) {
+    return (algorithm <= DIGEST_BLAKE3) ? digest_names[algorithm] : "unknown";
+}
+
+/*!
+ * @brief digest_init initializes a digest context
+ * @param ctx is a pointer to the context
+ * @param algorithm is the algorithm to use
+ * @return 0 if all went good, -1 else
+ */
+int digest_init(digest_ctx_t *ctx, digest_algorithm_t algorithm) {
+    ctx->algorithm = algorithm;
+    switch (algorithm) {
+        case DIGEST_MD5:
+            ctx->state.md5 = EVP_MD_CTX_new();
+            if (!ctx->state.md5 || 1 != EVP_DigestInit_ex(ctx->state.md5, EVP_md5(), NULL)) {
+                EVP_MD_CTX_free(ctx->state.md5);
+                ctx->state.md5 = NULL;
+                return -1;
+            }
+            return 0;
+        case DIGEST_XXH3:
+            xxh3_128_init(&ctx->state.xxh3);
+            return 0;
+        case DIGEST_BLAKE3:
+            blake3_init(&ctx->state.blake3);
+            return 0;
+    }
+    return -1;
+}
+
+/*!
+ * @brief digest_update feeds data into a digest context
+ * @param ctx is a pointer to the context
+ * @param data is the data to hash
+ * @param length is the length of data
+ * @return 0 if all went good, -1 else
+ */
+int digest_update(digest_ctx_t *ctx, const void *data, size_t length) {
+    switch (ctx->algorithm) {
+        case DIGEST_MD5:
+            return (1 == EVP_DigestUpdate(ctx->state.md5, data, length)) ? 0 : -1;
+        case DIGEST_XXH3:
+            xxh3_128_update(&ctx->state.xxh3, data, length);
+            return 0;
+        case DIGEST_BLAKE3:
+            blake3_update(&ctx->state.blake3, data, length);
+            return 0;
+    }
+    return -1;
+}
+
+/*!
+ * @brief digest_final computes the digest and releases the context
+ * @param ctx is a pointer to the context
+ * @param digest is the resulting digest
+ * @return 0 if all went good, -1 else
+ */
+int digest_final(digest_ctx_t *ctx, uint8_t digest[DIGEST_SIZE]) {
+    int result = 0;
+    switch (ctx->algorithm) {
+        case DIGEST_MD5: {
+            unsigned int md_len;
+            result = (1 == EVP_DigestFinal_ex(ctx->state.md5, digest, &md_len)) ? 0 : -1;
+            break;
+        }
+        case DIGEST_XXH3:
+            xxh3_128_final(&ctx->state.xxh3, digest);
+            break;
+        case DIGEST_BLAKE3:
+            blake3_final(&ctx->state.blake3, digest, DIGEST_SIZE);
+            break;
+    }
+    digest_free(ctx);
+    return result;
+}
+
+/*!
+ * @brief digest_free releases a digest context without computing the digest
+ * @param ctx is a pointer to the context
+ */
+void digest_free(digest_ctx_t *ctx) {
+    if (ctx->algorithm == DIGEST_MD5) {
+        EVP_MD_CTX_free(ctx->state.md5);
+        ctx->state.md5 = NULL;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <openssl/evp.h>
+#include "xxh3.h"
+#include "blake3.h"
+
+#define DIGEST_SIZE 16 // all algorithms give (or are truncated to) 16 bytes, the size of md5sum
+
+typedef enum {
+    DIGEST_MD5,
+    DIGEST_XXH3,
+    DIGEST_BLAKE3,
+} digest_algorithm_t;
+
+typedef struct {
+    digest_algorithm_t algorithm;
+    union {
+        EVP_MD_CTX *md5;
+        xxh3_state_t xxh3;
+        blake3_hasher_t blake3;
+    } state;
+} digest_ctx_t;
+
+int parse_digest_algorithm(const char *name, digest_algorithm_t *algorithm);
+const char *digest_algorithm_name(digest_algorithm_t algorithm);
+int digest_init(digest_ctx_t *ctx, digest_algorithm_t algorithm);
+int digest_update(digest_ctx_t *ctx, const void *data, size_t length);
+int digest_final(digest_ctx_t *ctx, uint8_t digest[DIGEST_SIZE]);
+void digest_free(digest_ctx_t *ctx);
@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+#include "file-compare.h"
+#include "file-properties.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+// Comparaison directe du contenu de deux fichiers de même taille : les deux fichiers sont lus en même
+// temps par gros blocs et la lecture s'arrête au premier bloc différent. Aucune empreinte n'est calculée.
+// En option, quelques échantillons (début, fin, intérieur) sont comparés d'abord, pour que les fichiers
+// qui diffèrent ne coûtent presque aucune lecture.
+
+/*!
+ * @brief init_file_compare prepares the buffers and the ring used to compare files
+ * @param compare is a pointer to the comparison context
+ * @param sampled enables the sampled prefilter
+ * @return 0 if all went good, -1 else (out of memory)
+ */
+int init_file_compare(file_compare_t *compare, bool sampled) {
+    memset(compare, 0, sizeof(file_compare_t));
+    compare->sampled = sampled;
+    compare->ring.ring_fd = -1;
+    for (int i = 0; i < 2; ++i) {
+        void *buffer = NULL;
+        if (posix_memalign(&buffer, HASH_BUFFER_ALIGNMENT, COMPARE_BLOCK_SIZE) != 0) {
+            printf("out of memory\n");
+            clear_file_compare(compare);
+            return -1;
+        }
+        compare->buffers[i] = buffer;
+    }
+    uring_init(&compare->ring, 2);              //sans io_uring : pread l'un après l'autre
+    return 0;
+}
+
+/*!
+ * @brief read_fully reads a whole range of a file with pread
+ * @return the number of bytes read (less at the end of the file), -1 in case of error
+ */
+static ssize_t read_fully(int fd, unsigned char *buffer, size_t length, uint64_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t bytes = pread(fd, buffer + done, length - done, offset + done);
+        if (bytes == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytes == -1) {
+            return -1;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        done += bytes;
+    }
+    return done;
+}
+
+/*!
+ * @brief give_up_buffers replaces the buffers of a comparison context while reads may still be in flight
+ * The kernel may still write into the old buffers, so they are deliberately not freed.
+ * @param compare is a pointer to the comparison context
+ * @return 0 if all went good, -1 else (out of memory)
+ */
+static int give_up_buffers(file_compare_t *compare) {
+    for (int i = 0; i < 2; ++i) {
+        void *buffer = NULL;
+        if (posix_memalign(&buffer, HASH_BUFFER_ALIGNMENT, COMPARE_BLOCK_SIZE) != 0) {
+            printf("out of memory\n");
+            compare->buffers[i] = NULL;
+            return -1;
+        }
+        compare->buffers[i] = buffer;
+    }
+    return 0;
+}
+
+/*!
+ * @brief read_pair reads the same range of both files into the two buffers, both reads in flight together
+ * @param compare is a pointer to the comparison context
+ * @param fds are the descriptors of the files
+ * @param length is the length of the range, up to COMPARE_BLOCK_SIZE
+ * @param offset is the start of the range
+ * When a submission or a wait fails, the ring is given up and this and later reads use pread.
+ * @return 0 if the range was read from both files, 1 if a file is shorter (changed meanwhile), -1 in case of error
+ */
+static int read_pair(file_compare_t *compare, int fds[2], size_t length, uint64_t offset) {
+    ssize_t results[2] = {-1, -1};
+    compare->bytes_read += 2 * length;
+
+    if (compare->ring.ring_fd >= 0) {
+        for (int i = 0; i < 2; ++i) {
+            struct io_uring_sqe *sqe = uring_get_sqe(&compare->ring);
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = fds[i];
+            sqe->addr = (uintptr_t)compare->buffers[i];
+            sqe->len = length;
+            sqe->off = offset;
+            sqe->user_data = i;
+        }
+        //seules les lectures soumises sont attendues : le noyau n'attend pas après une soumission partielle
+        int submitted = uring_submit_and_wait(&compare->ring, 2);
+        int completed = 0;
+        while (completed < submitted) {
+            struct io_uring_cqe *cqe = uring_peek_cqe(&compare->ring);
+            if (!cqe) {
+                if (uring_submit_and_wait(&compare->ring, 1) < 0) {
+                    break;
+                }
+                continue;
+            }
+            results[cqe->user_data] = cqe->res;
+            uring_cqe_seen(&compare->ring);
+            completed++;
+        }
+        if (submitted < 2 || completed < submitted) {  //échec : l'anneau est abandonné, pread pour la suite
+            bool in_flight = completed < submitted;
+            uring_exit(&compare->ring);
+            if (in_flight) {                    //lectures relancées dans de nouveaux tampons
+                results[0] = results[1] = -1;
+                if (give_up_buffers(compare) == -1) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        if (results[i] >= 0 && (size_t)results[i] < length) {   //lecture partielle : on complète
+            ssize_t rest = read_fully(fds[i], compare->buffers[i] + results[i], length - results[i], offset + results[i]);
+            results[i] = (rest == -1) ? -1 : results[i] + rest;
+        } else if (results[i] < 0) {            //sans io_uring, ou requête refusée
+            results[i] = read_fully(fds[i], compare->buffers[i], length, offset);
+        }
+        if (results[i] == -1) {
+            return -1;
+        }
+    }
+    return ((size_t)results[0] == length && (size_t)results[1] == length) ? 0 : 1;
+}
+
+/*!
+ * @brief samples_differ compares the head, the tail and a few interior samples of both files
+ * @return true if a sample differs (or cannot be read), false else
+ */
+static bool samples_differ(file_compare_t *compare, int fds[2], uint64_t size) {
+    uint64_t step = (size - COMPARE_SAMPLE_SIZE) / (COMPARE_INTERIOR_SAMPLES + 1);
+    for (int i = 0; i <= COMPARE_INTERIOR_SAMPLES + 1; ++i) {
+        uint64_t offset = (step * i) & ~(uint64_t)(COMPARE_SAMPLE_SIZE - 1);     //échantillons alignés sur les pages
+        if (i == COMPARE_INTERIOR_SAMPLES + 1) {                //la fin exacte du fichier
+            offset = size - COMPARE_SAMPLE_SIZE;
+        }
+        if (read_pair(compare, fds, COMPARE_SAMPLE_SIZE, offset) != 0
+            || memcmp(compare->buffers[0], compare->buffers[1], COMPARE_SAMPLE_SIZE) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * @brief compare_files_content tests if two files of the same size have the same content
+ * @param compare is a pointer to the comparison context
+ * @param lhd_path is the path of the first file
+ * @param rhd_path is the path of the second file
+ * @param size is the size of both files
+ * @return 0 if the contents are equal, 1 if they differ, -1 if a file cannot be read
+ */
+int compare_files_content(file_compare_t *compare, char *lhd_path, char *rhd_path, uint64_t size) {
+    int fds[2];
+    fds[0] = open(lhd_path, O_RDONLY | O_CLOEXEC);
+    fds[1] = open(rhd_path, O_RDONLY | O_CLOEXEC);
+    if (fds[0] == -1 || fds[1] == -1) {
+        if (fds[0] != -1) {
+            close(fds[0]);
+        }
+        if (fds[1] != -1) {
+            close(fds[1]);
+        }
+        return -1;
+    }
+
+    int result = 0;
+    if (compare->sampled && size >= 2 * COMPARE_BLOCK_SIZE && samples_differ(compare, fds, size)) {
+        result = 1;                             //différence trouvée sans lire les fichiers
+    }
+
+    if (result == 0) {
+        posix_fadvise(fds[0], 0, 0, POSIX_FADV_SEQUENTIAL);
+        posix_fadvise(fds[1], 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    for (uint64_t offset = 0; result == 0 && offset < size; offset += COMPARE_BLOCK_SIZE) {
+        size_t length = (size - offset < COMPARE_BLOCK_SIZE) ? size - offset : COMPARE_BLOCK_SIZE;
+        result = read_pair(compare, fds, length, offset);
+        if (result == 0 && memcmp(compare->buffers[0], compare->buffers[1], length) != 0) {    //premier bloc différent
+            result = 1;
+        }
+    }
+
+    if (result == 0) {                          //taille changée depuis la liste : les fichiers diffèrent
+        char extra;
+        if (pread(fds[0], &extra, 1, size) != 0 || pread(fds[1], &extra, 1, size) != 0) {
+            result = 1;
+        }
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    return result;
+}
+
+/*!
+ * @brief clear_file_compare releases the buffers and the ring of a comparison context
+ * @param compare is a pointer to the comparison context
+ */
+void clear_file_compare(file_compare_t *compare) {
+    free(compare->buffers[0]);
+    free(compare->buffers[1]);
+    compare->buffers[0] = compare->buffers[1] = NULL;
+    uring_exit(&compare->ring);
+}
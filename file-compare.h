@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "uring.h"
+
+#define COMPARE_BLOCK_SIZE (1024 * 1024) // bytes read from each file at once
+#define COMPARE_SAMPLE_SIZE 4096
+#define COMPARE_INTERIOR_SAMPLES 6 // samples between the head and the tail
+
+typedef struct {
+    uring_t ring; // both reads of a block are submitted together, ring_fd is -1 without io_uring
+    unsigned char *buffers[2];
+    bool sampled; // check head, tail and interior samples before reading the files
+    uint64_t bytes_read;
+} file_compare_t;
+
+int init_file_compare(file_compare_t *compare, bool sampled);
+int compare_files_content(file_compare_t *compare, char *lhd_path, char *rhd_path, uint64_t size);
+void clear_file_compare(file_compare_t *compare);
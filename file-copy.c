@@ -0,0 +1,213 @@
+#define _GNU_SOURCE
+#include "file-copy.h"
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+
+// Copie du contenu d'un fichier, de la méthode la plus rapide à la plus générale :
+// clonage (FICLONE), copie dans le noyau (copy_file_range), sendfile, puis read/write.
+// Chaque méthode boucle jusqu'à la fin de la zone à copier ; si une méthode n'est pas supportée,
+// la suivante reprend à l'octet où la précédente s'est arrêtée.
+// Pour un fichier creux, seules les zones de données (SEEK_DATA/SEEK_HOLE) sont copiées : les trous
+// sont recréés en fixant la taille de la destination, sans rien écrire.
+
+static const char *strategy_names[] = {
+    [COPY_FAILED] = "failed",
+    [COPY_CLONE] = "clone",
+    [COPY_FILE_RANGE] = "copy_file_range",
+    [COPY_SENDFILE] = "sendfile",
+    [COPY_READ_WRITE] = "read/write",
+};
+
+/*!
+ * @brief copy_strategy_name gives the name of a copy strategy
+ * @param strategy is the strategy
+ * @return the name of the strategy
+ */
+const char *copy_strategy_name(copy_strategy_t strategy) {
+    return (strategy <= COPY_READ_WRITE) ? strategy_names[strategy] : "unknown";
+}
+
+/*!
+ * @brief is_unsupported tells if an error means that a copy method cannot be used for these files
+ */
+static bool is_unsupported(int error) {
+    return error == EXDEV || error == EINVAL || error == ENOSYS || error == EOPNOTSUPP || error == ENOTTY
+           || error == EBADF || error == ETXTBSY;
+}
+
+static inline size_t chunk_length(off_t offset, off_t end) {
+    return (end - offset < COPY_CHUNK_SIZE) ? (size_t)(end - offset) : COPY_CHUNK_SIZE;
+}
+
+/*!
+ * @brief copy_with_file_range copies a range of the source with copy_file_range
+ * @param end is the end of the range (stops before at the end of the source)
+ * @return 0 when the end is reached, 1 if the method is not supported (from *offset), -1 in case of error
+ */
+static int copy_with_file_range(int source_fd, int destination_fd, off_t *offset, off_t end) {
+    while (*offset < end) {
+        off_t destination_offset = *offset;
+        ssize_t copied = copy_file_range(source_fd, offset, destination_fd, &destination_offset, chunk_length(*offset, end), 0);
+        if (copied == 0) {
+            return 0;
+        }
+        if (copied == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return is_unsupported(errno) ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+/*!
+ * @brief copy_with_sendfile copies a range of the source with sendfile
+ * @param end is the end of the range (stops before at the end of the source)
+ * @return 0 when the end is reached, 1 if the method is not supported (from *offset), -1 in case of error
+ */
+static int copy_with_sendfile(int source_fd, int destination_fd, off_t *offset, off_t end) {
+    if (lseek(destination_fd, *offset, SEEK_SET) == -1) {          //sendfile écrit à la position courante
+        return 1;
+    }
+    while (*offset < end) {
+        ssize_t copied = sendfile(destination_fd, source_fd, offset, chunk_length(*offset, end));   //jamais plus de 2 Gio par appel
+        if (copied == 0) {
+            return 0;
+        }
+        if (copied == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return is_unsupported(errno) ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+/*!
+ * @brief copy_with_read_write copies a range of the source through a buffer
+ * @param end is the end of the range (stops before at the end of the source)
+ * @return 0 when the end is reached, -1 in case of error
+ */
+static int copy_with_read_write(int source_fd, int destination_fd, off_t *offset, off_t end) {
+    char *buffer = malloc(COPY_BUFFER_SIZE);
+    if (!buffer) {
+        return -1;
+    }
+
+    int result = 0;
+    while (*offset < end) {
+        size_t wanted = (end - *offset < COPY_BUFFER_SIZE) ? (size_t)(end - *offset) : COPY_BUFFER_SIZE;
+        ssize_t bytes = pread(source_fd, buffer, wanted, *offset);
+        if (bytes == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            result = (bytes == 0) ? 0 : -1;
+            break;
+        }
+        for (ssize_t written = 0; written < bytes;) {        //écritures partielles
+            ssize_t count = pwrite(destination_fd, buffer + written, bytes - written, *offset + written);
+            if (count == -1 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                free(buffer);
+                return -1;
+            }
+            written += count;
+        }
+        *offset += bytes;
+    }
+
+    free(buffer);
+    return result;
+}
+
+/*!
+ * @brief copy_range copies a range of the source to the same offset of the destination
+ * The methods are tried from the strategy already in use, which is updated when one is not supported.
+ * @return 0 if all went good, -1 else
+ */
+static int copy_range(int source_fd, int destination_fd, off_t offset, off_t end, copy_strategy_t *strategy) {
+    int result = 1;
+    if (*strategy <= COPY_FILE_RANGE) {
+        result = copy_with_file_range(source_fd, destination_fd, &offset, end);
+        if (result == 0) {
+            *strategy = COPY_FILE_RANGE;
+            return 0;
+        }
+    }
+    if (result == 1 && *strategy <= COPY_SENDFILE) {
+        result = copy_with_sendfile(source_fd, destination_fd, &offset, end);
+        if (result == 0) {
+            *strategy = COPY_SENDFILE;
+            return 0;
+        }
+    }
+    if (result == 1 && copy_with_read_write(source_fd, destination_fd, &offset, end) == 0) {
+        *strategy = COPY_READ_WRITE;
+        return 0;
+    }
+    return -1;
+}
+
+/*!
+ * @brief copy_file_content copies the whole content of a file into an empty file
+ * Holes of a sparse source are kept: only its data extents are copied.
+ * @param source_fd is the descriptor of the source file
+ * @param destination_fd is the descriptor of the destination file (empty, opened for writing)
+ * @param size is the size of the source file
+ * @param report is a pointer to the report of the copy (strategy is COPY_FAILED on error)
+ * @return 0 if all went good, -1 else
+ */
+int copy_file_content(int source_fd, int destination_fd, uint64_t size, copy_report_t *report) {
+    report->strategy = COPY_FAILED;
+    report->sparse = false;
+    report->data_bytes = size;
+
+    if (size > 0 && ioctl(destination_fd, FICLONE, source_fd) == 0) {        //partage des blocs, instantané
+        report->strategy = COPY_CLONE;
+        return 0;
+    }
+
+    off_t hole = (size > 0) ? lseek(source_fd, 0, SEEK_HOLE) : -1;
+    if (hole == -1 || (uint64_t)hole >= size) {         //fichier plein (ou trous non signalés) : d'un bloc
+        copy_strategy_t strategy = COPY_FILE_RANGE;
+        if (copy_range(source_fd, destination_fd, 0, INT64_MAX, &strategy) == -1) {
+            return -1;
+        }
+        report->strategy = strategy;
+        return 0;
+    }
+
+    report->sparse = true;                      //fichier creux : zones de données seulement
+    report->data_bytes = 0;
+    copy_strategy_t strategy = COPY_FILE_RANGE;
+    off_t data = lseek(source_fd, 0, SEEK_DATA);
+    while (data != -1 && (uint64_t)data < size) {
+        hole = lseek(source_fd, data, SEEK_HOLE);
+        if (hole == -1) {
+            return -1;
+        }
+        if (copy_range(source_fd, destination_fd, data, hole, &strategy) == -1) {
+            return -1;
+        }
+        report->data_bytes += hole - data;
+        data = lseek(source_fd, hole, SEEK_DATA);
+    }
+    if (data == -1 && errno != ENXIO) {         //ENXIO : plus de données jusqu'à la fin
+        return -1;
+    }
+    if (ftruncate(destination_fd, size) == -1) {        //trous jusqu'à la taille du fichier
+        return -1;
+    }
+    report->strategy = strategy;
+    return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define COPY_CHUNK_SIZE (16 * 1024 * 1024) // bytes asked per copy_file_range/sendfile call
+#define COPY_BUFFER_SIZE (1024 * 1024) // buffer of the read/write fallback
+
+typedef enum {
+    COPY_FAILED,
+    COPY_CLONE, // reflink, no data copied (btrfs, XFS...)
+    COPY_FILE_RANGE, // in-kernel copy (may be offloaded by the filesystem)
+    COPY_SENDFILE,
+    COPY_READ_WRITE,
+} copy_strategy_t;
+
+typedef struct {
+    copy_strategy_t strategy; // method that completed the copy
+    bool sparse; // only the data extents were copied, holes were recreated
+    uint64_t data_bytes; // bytes copied
+} copy_report_t;
+
+int copy_file_content(int source_fd, int destination_fd, uint64_t size, copy_report_t *report);
+const char *copy_strategy_name(copy_strategy_t strategy);
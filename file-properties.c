@@ -1,7 +1,9 @@
+#define _GNU_SOURCE
 #include <sys/stat.h>
 #include "file-properties.h"
 #include <dirent.h>
-#include <openssl/evp.h>
+#include "digest.h"
+#include "md5-mb.h"
 #include <unistd.h>
 #include <assert.h>
 #include <string.h>
@@ -9,12 +11,80 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include "utility.h"
+#include "uring.h"
+#include "map-guard.h"
+#include <sys/sysmacros.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 #include "configuration.h"
 
+static digest_algorithm_t files_digest_algorithm = DIGEST_MD5; // algorithm used by compute_file_md5
 
+/*!
+ * @brief set_digest_algorithm selects the algorithm of the files digests for the whole process
+ * @param algorithm is the algorithm to use
+ */
+void set_digest_algorithm(digest_algorithm_t algorithm) {
+    files_digest_algorithm = algorithm;
+}
+
+/*!
+ * @brief get_digest_algorithm gives the algorithm of the files digests
+ * @return the algorithm in use
+ */
+digest_algorithm_t get_digest_algorithm(void) {
+    return files_digest_algorithm;
+}
+
+static int tree_hash_threads = 0; // threads hashing the chunks of very large files, 0 if disabled
+
+/*!
+ * @brief set_tree_hash_threads enables the tree hash of very large files (from TREE_HASH_MIN_SIZE)
+ * @param threads_count is the number of threads hashing the chunks, 0 to hash the files whole
+ */
+void set_tree_hash_threads(int threads_count) {
+    tree_hash_threads = (threads_count > 0) ? threads_count : 0;
+}
+
+
+/*!
+ * @brief set_entry_properties fills an entry with the properties returned by stat or statx
+ * @param entry is the files list entry
+ * @param stats is a pointer to the properties of the file
+ * @return -1 if the entry is neither a file nor a directory, 0 else
+ */
+static int set_entry_properties(files_list_entry_t *entry, struct stat *stats) {
+    if (S_ISDIR(stats->st_mode)) {                   // si c'est un dossier 
+
+        entry->entry_type = DOSSIER;                //entry_type
+        
+        entry->mode = stats->st_mode;                //mode
+
+    } else if (S_ISREG(stats->st_mode)) {               //sinon si c'est un fichier
+
+        entry->mtime = stats->st_mtim;              //m_time (secondes et nanosecondes)
+
+        entry->size = stats->st_size;                    //size
+
+        entry->entry_type = FICHIER;                   //entry_type
 
+        entry->mode = stats->st_mode;                //mode
 
+        entry->dev = stats->st_dev;                 //identité du fichier pour le cache d'empreintes
+        entry->inode = stats->st_ino;
+        entry->ctime = stats->st_ctim;
+
+    } else {                                        //sinon probleme
+        return -1;
+    }
+
+    return 0;
+}
 
 /*!
  * @brief get_file_stats gets all of the required information for a file (inc. directories)
@@ -25,10 +95,10 @@
  *   - mtime (in nanoseconds)
  *   - size
  *   - entry type (FICHIER)
- *   - MD5 sum
  * - for directories:
  *   - mode
  *   - entry type (DOSSIER)
+ * The MD5 sum is not computed here, but only when a comparison needs it (@see ensure_file_md5)
  * @return -1 in case of error, 0 else
  */
 int get_file_stats(files_list_entry_t *entry) {
@@ -42,97 +112,622 @@ int get_file_stats(files_list_entry_t *entry) {
         return -1;
     }
 
-    if (S_ISDIR(stats.st_mode)) {                   // si c'est un dossier 
+    if (set_entry_properties(entry, &stats) == -1) {
+        return -1;
+    }
+
+    return 0;
+    
+    
+}
+
+/*!
+ * @brief get_files_list_stats gets the information of all the entries of a list (@see get_file_stats)
+ * Metadata are requested by batches of statx through io_uring, so that many requests are in flight
+ * at once instead of one blocking lstat per file. When io_uring is not available, or a request fails,
+ * it falls back to get_file_stats for the entries concerned. When a submission or a wait fails, the ring
+ * is given up: the entries without a result, then the rest of the list, use get_file_stats.
+ * @param list is the files list
+ * @return the number of entries in error, 0 if all went good
+ */
+int get_files_list_stats(files_list_t *list) {
+    if (!list) {
+        return -1;
+    }
+
+    int errors = 0;
+    uring_t ring;
+    struct statx *buffers = NULL;
+    files_list_entry_t **batch = NULL;
 
+    if (uring_init(&ring, STATS_BATCH_SIZE) == 0) {
+        buffers = malloc(ring.entries * sizeof(struct statx));
+        batch = malloc(ring.entries * sizeof(files_list_entry_t *));
+        if (!buffers || !batch) {
+            uring_exit(&ring);
+        }
+    }
 
-        entry->entry_type = DOSSIER;                //entry_type
-        
-        entry->mode = stats.st_mode;                //mode
+    if (ring.ring_fd < 0) {                     //pas d'io_uring : un lstat par entrée
+        free(buffers);
+        free(batch);
+        for (files_list_entry_t *cursor = list->head; cursor != NULL; cursor = cursor->next) {
+            if (get_file_stats(cursor) == -1) {
+                errors++;
+            }
+        }
+        return errors;
+    }
+
+    files_list_entry_t *cursor = list->head;
+    bool ring_failed = false;                   //soumission ou attente en échec : l'anneau est abandonné
+    bool in_flight = false;                     //requêtes peut-être encore en cours dans le noyau
+    while (cursor != NULL && !ring_failed) {
+        unsigned count = 0;
+        struct io_uring_sqe *sqe;
+        while (cursor != NULL && (sqe = uring_get_sqe(&ring)) != NULL) {      //remplissage d'un lot
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uintptr_t)cursor->path_and_name;
+            sqe->len = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_CTIME | STATX_INO;
+            sqe->off = (uintptr_t)&buffers[count];
+            sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+            sqe->user_data = count;
+            batch[count++] = cursor;
+            cursor = cursor->next;
+        }
+
+        //le noyau n'attend pas après une soumission partielle : seules les requêtes soumises sont attendues
+        int submitted = uring_submit_and_wait(&ring, count);
+        if (submitted < (int)count) {
+            ring_failed = true;
+            submitted = submitted < 0 ? 0 : submitted;
+        }
 
+        unsigned completed = 0;
+        while (completed < (unsigned)submitted) {       //récupération des résultats du lot
+            struct io_uring_cqe *cqe = uring_peek_cqe(&ring);
+            if (!cqe) {
+                if (uring_submit_and_wait(&ring, 1) < 0) {
+                    ring_failed = true;
+                    in_flight = true;
+                    break;
+                }
+                continue;
+            }
+
+            files_list_entry_t *entry = batch[cqe->user_data];
+            struct statx *stats = &buffers[cqe->user_data];
+            batch[cqe->user_data] = NULL;       //traitée
+            if (cqe->res < 0) {                 //requete refusée (ancien noyau...) : lstat
+                if (get_file_stats(entry) == -1) {
+                    errors++;
+                }
+            } else {
+                struct stat converted;              //même traitement que pour lstat
+                memset(&converted, 0, sizeof(converted));
+                converted.st_mode = stats->stx_mode;
+                converted.st_size = stats->stx_size;
+                converted.st_mtim.tv_sec = stats->stx_mtime.tv_sec;
+                converted.st_mtim.tv_nsec = stats->stx_mtime.tv_nsec;
+                converted.st_ctim.tv_sec = stats->stx_ctime.tv_sec;
+                converted.st_ctim.tv_nsec = stats->stx_ctime.tv_nsec;
+                converted.st_dev = makedev(stats->stx_dev_major, stats->stx_dev_minor);
+                converted.st_ino = stats->stx_ino;
+                if (set_entry_properties(entry, &converted) == -1) {
+                    errors++;
+                }
+            }
+            uring_cqe_seen(&ring);
+            completed++;
+        }
+
+        for (unsigned i = 0; ring_failed && i < count; ++i) {     //entrées du lot sans résultat : lstat
+            if (batch[i] && get_file_stats(batch[i]) == -1) {
+                errors++;
+            }
+        }
+    }
 
+    for (; cursor != NULL; cursor = cursor->next) {     //reste de la liste après l'abandon de l'anneau
+        if (get_file_stats(cursor) == -1) {
+            errors++;
+        }
+    }
 
-    } else if (S_ISREG(stats.st_mode)) {               //sinon si c'est un fichier
+    uring_exit(&ring);
+    if (!in_flight) {                           //sinon le noyau peut encore écrire dans les tampons : ils ne sont pas libérés
+        free(buffers);
+    }
+    free(batch);
+    return errors;
+}
 
-        entry->mtime.tv_nsec = stats.st_mtime;              //m_time en nano 
 
-        entry->size = stats.st_size;                    //size
 
-        if (compute_file_md5(entry) == -1) {
+/*!
+ * @brief read_into_digest feeds a digest with the content of a file, read through a buffer
+ * @param ctx is the digest context
+ * @param fd is the descriptor of the file
+ * @param buffer is the read buffer
+ * @param buffer_size is the size of the buffer
+ * @return -1 in case of error, 0 else
+ */
+static int read_into_digest(digest_ctx_t *ctx, int fd, unsigned char *buffer, size_t buffer_size) {
+    ssize_t bytes;
+    while ((bytes = read(fd, buffer, buffer_size)) != 0) {         //lis le fichier par morceaux
+        if (bytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (digest_update(ctx, buffer, bytes) == -1) {      //met à jour le contexte avec les donné lues
             return -1;
         }
+    }
+    return 0;
+}
 
-        entry->entry_type = FICHIER;                   //entry_type
+/*!
+ * @brief sparse_into_digest feeds a digest with the content of a sparse file, reading only its data extents
+ * Holes are fed as zeros without reading them (SEEK_DATA/SEEK_HOLE).
+ * @param ctx is the digest context
+ * @param fd is the descriptor of the file
+ * @param size is the size of the file
+ * @param buffer is the read buffer
+ * @param buffer_size is the size of the buffer
+ * @return -1 in case of error, 1 if holes cannot be found (use read_into_digest), 0 else
+ */
+static int sparse_into_digest(digest_ctx_t *ctx, int fd, uint64_t size, unsigned char *buffer, size_t buffer_size) {
+    uint64_t offset = 0;
+    while (offset < size) {
+        off_t data = lseek(fd, offset, SEEK_DATA);
+        if (data == -1 && errno != ENXIO) {
+            return (offset == 0) ? 1 : -1;      //pas de SEEK_DATA sur ce système de fichiers
+        }
+        uint64_t data_start = (data == -1 || (uint64_t)data > size) ? size : (uint64_t)data;     //ENXIO : trou final
+
+        if (data_start > offset) {              //trou : des zéros sans lecture
+            memset(buffer, 0, buffer_size);
+            while (offset < data_start) {
+                size_t length = (data_start - offset < buffer_size) ? data_start - offset : buffer_size;
+                if (digest_update(ctx, buffer, length) == -1) {
+                    return -1;
+                }
+                offset += length;
+            }
+        }
+        if (offset >= size) {
+            break;
+        }
 
-        entry->mode = stats.st_mode;                //mode
+        off_t hole = lseek(fd, offset, SEEK_HOLE);
+        uint64_t data_end = (hole == -1 || (uint64_t)hole > size) ? size : (uint64_t)hole;
+        while (offset < data_end) {             //zone de données
+            size_t wanted = (data_end - offset < buffer_size) ? data_end - offset : buffer_size;
+            ssize_t bytes = pread(fd, buffer, wanted, offset);
+            if (bytes == -1 && errno == EINTR) {
+                continue;
+            }
+            if (bytes <= 0 || digest_update(ctx, buffer, bytes) == -1) {
+                return -1;
+            }
+            offset += bytes;
+        }
+    }
+    return 0;
+}
 
-    } else {                                        //sinon probleme
+/*!
+ * @brief map_into_digest feeds a digest with the content of a file, mapped in memory
+ * A file truncated during the read raises SIGBUS on the missing pages: the read is then abandoned (@see map_guard_enter).
+ * @param ctx is the digest context
+ * @param fd is the descriptor of the file
+ * @param size is the size of the file
+ * @return -1 in case of error, 1 if the file could not be mapped (use read_into_digest), 0 else
+ */
+static int map_into_digest(digest_ctx_t *ctx, int fd, size_t size) {
+    unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        return 1;
+    }
+
+    map_guard_t guard;
+    if (sigsetjmp(guard.env, 1) != 0) {             //fichier tronqué pendant la lecture
+        munmap(data, size);
         return -1;
     }
+    if (map_guard_enter(&guard) == -1) {
+        munmap(data, size);
+        return 1;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);           //lecture anticipée agressive, pages libérées derrière
+
+    int result = 0;
+    for (size_t offset = 0; offset < size; offset += HASH_BUFFER_SIZE) {      //par morceaux, comme en lecture
+        size_t length = (size - offset < HASH_BUFFER_SIZE) ? size - offset : HASH_BUFFER_SIZE;
+        if (digest_update(ctx, data + offset, length) == -1) {
+            result = -1;
+            break;
+        }
+    }
+    map_guard_leave(&guard);
 
-    return 0;
-    
-    
+    munmap(data, size);
+    return result;
 }
 
+typedef struct {
+    int fd;
+    uint64_t size;
+    size_t chunks_count;
+    atomic_size_t next_chunk;
+    atomic_bool failed;
+    uint8_t (*digests)[DIGEST_SIZE]; // digest of each chunk, in file order
+} tree_hash_job_t;
 
+/*!
+ * @brief hash_chunk computes the digest of one chunk of a file
+ * @param job is the tree hash of the file
+ * @param chunk is the index of the chunk
+ * @param buffer is a read buffer of HASH_BUFFER_SIZE bytes
+ * @return -1 in case of error, 0 else
+ */
+static int hash_chunk(tree_hash_job_t *job, size_t chunk, unsigned char *buffer) {
+    uint64_t offset = (uint64_t)chunk * TREE_HASH_CHUNK_SIZE;
+    uint64_t end = (job->size - offset < TREE_HASH_CHUNK_SIZE) ? job->size : offset + TREE_HASH_CHUNK_SIZE;
+
+    digest_ctx_t ctx;
+    if (digest_init(&ctx, files_digest_algorithm) == -1) {
+        return -1;
+    }
+    while (offset < end) {
+        size_t wanted = (end - offset < HASH_BUFFER_SIZE) ? end - offset : HASH_BUFFER_SIZE;
+        ssize_t bytes = pread(job->fd, buffer, wanted, offset);
+        if (bytes == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0 || digest_update(&ctx, buffer, bytes) == -1) {     //fichier raccourci pendant la lecture
+            digest_free(&ctx);
+            return -1;
+        }
+        offset += bytes;
+    }
+    return digest_final(&ctx, job->digests[chunk]);
+}
+
+/*!
+ * @brief tree_hash_worker hashes chunks of a file until all of them are taken
+ * @param parameters is a pointer to the tree_hash_job_t of the file
+ */
+static void *tree_hash_worker(void *parameters) {
+    tree_hash_job_t *job = (tree_hash_job_t *)parameters;
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, HASH_BUFFER_ALIGNMENT, HASH_BUFFER_SIZE) != 0) {
+        atomic_store(&job->failed, true);
+        return NULL;
+    }
+
+    while (!atomic_load(&job->failed)) {
+        size_t chunk = atomic_fetch_add(&job->next_chunk, 1);
+        if (chunk >= job->chunks_count) {
+            break;
+        }
+        if (hash_chunk(job, chunk, buffer) == -1) {
+            atomic_store(&job->failed, true);
+        }
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+/*!
+ * @brief tree_hash_file computes the tree hash of a very large file
+ * The file is cut in chunks of TREE_HASH_CHUNK_SIZE bytes hashed on several threads; the root digest is
+ * the digest of the file size followed by the chunk digests, so it does not depend on the threads count.
+ * @param fd is the descriptor of the file
+ * @param size is the size of the file
+ * @param digest is the resulting root digest
+ * @return -1 in case of error, 0 else
+ */
+static int tree_hash_file(int fd, uint64_t size, uint8_t digest[DIGEST_SIZE]) {
+    tree_hash_job_t job;
+    job.fd = fd;
+    job.size = size;
+    job.chunks_count = (size + TREE_HASH_CHUNK_SIZE - 1) / TREE_HASH_CHUNK_SIZE;
+    atomic_init(&job.next_chunk, 0);
+    atomic_init(&job.failed, false);
+    job.digests = malloc(job.chunks_count * DIGEST_SIZE);
+    if (!job.digests) {
+        printf("out of memory\n");
+        return -1;
+    }
+
+    int threads_count = ((size_t)tree_hash_threads < job.chunks_count) ? tree_hash_threads : (int)job.chunks_count;
+    pthread_t threads[threads_count];
+    int started = 1;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    for (; started < threads_count; ++started) {
+        if (pthread_create(&threads[started], NULL, tree_hash_worker, &job) != 0) {
+            break;                              //moins de threads : même résultat
+        }
+    }
+    tree_hash_worker(&job);                     //le thread appelant hache aussi
+    for (int i = 1; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    int result = -1;
+    digest_ctx_t ctx;
+    if (!atomic_load(&job.failed) && digest_init(&ctx, files_digest_algorithm) == 0) {      //racine
+        uint8_t size_bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            size_bytes[i] = (uint8_t)(size >> (8 * i));
+        }
+        if (digest_update(&ctx, size_bytes, sizeof(size_bytes)) == 0
+            && digest_update(&ctx, job.digests, job.chunks_count * DIGEST_SIZE) == 0) {
+            result = digest_final(&ctx, digest);
+        } else {
+            digest_free(&ctx);
+        }
+    }
+
+    free(job.digests);
+    return result;
+}
+
+static pthread_key_t read_buffer_key;
+static pthread_once_t read_buffer_once = PTHREAD_ONCE_INIT;
+
+static void create_read_buffer_key(void) {
+    pthread_key_create(&read_buffer_key, free);
+}
+
+/*!
+ * @brief get_read_buffer gives the aligned read buffer of the calling thread, allocated on its first use
+ * Allocating HASH_BUFFER_SIZE for each file costs an mmap, its page faults and a munmap (about 50 µs),
+ * more than reading and hashing a 64 KiB file. The buffer is freed when the thread ends.
+ * @return a pointer to the buffer, NULL if out of memory
+ */
+static unsigned char *get_read_buffer(void) {
+    pthread_once(&read_buffer_once, create_read_buffer_key);
+    void *buffer = pthread_getspecific(read_buffer_key);
+    if (!buffer) {
+        if (posix_memalign(&buffer, HASH_BUFFER_ALIGNMENT, HASH_BUFFER_SIZE) != 0) {
+            return NULL;
+        }
+        if (pthread_setspecific(read_buffer_key, buffer) != 0) {
+            free(buffer);
+            return NULL;
+        }
+    }
+    return buffer;
+}
 
 /*!
- * @brief compute_file_md5 computes a file's MD5 sum
+ * @brief compute_file_md5 computes a file's digest (MD5 by default, see set_digest_algorithm)
  * @param the pointer to the files list entry
  * @return -1 in case of error, 0 else
- * Use libcrypto functions from openssl/evp.h
+ * The digest is stored in md5sum whatever the algorithm.
+ * Very large files are tree hashed when enabled (@see set_tree_hash_threads).
+ * The file is read with a strategy depending on its size:
+ * - small files: one read through a stack buffer
+ * - medium files: large aligned buffer (one per thread), with sequential access advice to the kernel
+ * - large files (from HASH_MMAP_THRESHOLD): mmap with MADV_SEQUENTIAL
+ * - sparse files: data extents only, holes are hashed as zeros without being read
 */
 int compute_file_md5(files_list_entry_t *entry) {
 
     if (!entry || entry->entry_type != FICHIER) { // verifie si entry est null ou si ce n'est pas un fichier
         return -1;
     }
-    
-    if (entry->entry_type != FICHIER || !entry) {          //si ce n'est pas un fichier ou la liste est
+
+    int fd = open(entry->path_and_name, O_RDONLY | O_CLOEXEC); // ouverture du fichier
+    if (fd == -1) {        //si l'ouverture n'a pas marché
         return -1;
     }
 
-    FILE *file = fopen(entry->path_and_name, "rb"); // ouverture du fichier
-    if (!file) {        //si l'ouverture n'a pas marché
+    struct stat stats;                  //taille réelle au moment de la lecture
+    if (fstat(fd, &stats) == -1) {
+        close(fd);
         return -1;
     }
 
-    EVP_MD_CTX *mdctx = EVP_MD_CTX_new();   //creer le contexte
-    const EVP_MD *md = EVP_md5();           // utilisation de l'algorithme MD5 de evp.h
+    if (tree_hash_threads > 0 && (uint64_t)stats.st_size >= TREE_HASH_MIN_SIZE) {     //très gros fichier : par morceaux
+        int tree_result = tree_hash_file(fd, stats.st_size, entry->md5sum);
+        close(fd);
+        if (tree_result == -1) {
+            return -1;
+        }
+        entry->md5_computed = true;
+        return 0;
+    }
 
-    if ((!mdctx || !md)||(1 != EVP_DigestInit_ex(mdctx, md, NULL))) {       //vérifie que la creation du contexte et l'initialisation de l'algo
-        EVP_MD_CTX_free(mdctx);             //on libere la memoire
-        fclose(file);                       //on ferme le fichier
+    digest_ctx_t ctx;
+    if (digest_init(&ctx, files_digest_algorithm) == -1) {      //creer le contexte de l'algorithme choisi
+        close(fd);                       //on ferme le fichier
         return -1;
     }
 
-    unsigned char buffer[1024];             //pour lire le fichier 
-    size_t bytes;
-    while ((bytes = fread(buffer, 1, sizeof(buffer), file)) != 0) {         //lis le fichier par morceaux
-        if (1 != EVP_DigestUpdate(mdctx, buffer, bytes)) {      //met à jour le contexte avec les donné lues
-            EVP_MD_CTX_free(mdctx);                     //on libere la memoire
-            fclose(file);                   //on ferme le fichier
-            return -1;
+    int result;
+    if ((size_t)stats.st_size < HASH_SMALL_FILE_SIZE) {            //petit fichier : tampon sur la pile
+        unsigned char buffer[HASH_SMALL_FILE_SIZE];
+        result = read_into_digest(&ctx, fd, buffer, sizeof(buffer));
+    } else {
+        result = 1;
+        bool sparse = (uint64_t)stats.st_blocks * 512 < (uint64_t)stats.st_size;    //moins de blocs que la taille : trous
+        if (!sparse && (size_t)stats.st_size >= HASH_MMAP_THRESHOLD) {        //gros fichier : projection en mémoire
+            result = map_into_digest(&ctx, fd, stats.st_size);
+        }
+        if (result == 1) {                                          //fichier moyen : gros tampon aligné
+            unsigned char *buffer = get_read_buffer();
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            if (!buffer) {
+                result = -1;
+            } else {
+                if (sparse) {                   //fichier creux : zones de données seulement
+                    result = sparse_into_digest(&ctx, fd, stats.st_size, buffer, HASH_BUFFER_SIZE);
+                }
+                if (result == 1) {
+                    result = read_into_digest(&ctx, fd, buffer, HASH_BUFFER_SIZE);
+                }
+            }
         }
     }
 
-    unsigned int md_len;                //pour stocker la longeur de la somme md5
-    if (1 != EVP_DigestFinal_ex(mdctx, entry->md5sum, &md_len)) {           //calcul du md5 et stockage
-        EVP_MD_CTX_free(mdctx);             //on libere la memoire
-        fclose(file);               //on ferme le fichier
+    if (result != 0) {
+        digest_free(&ctx);              //on libere la memoire
+        close(fd);               //on ferme le fichier
+        return -1;
+    }
+    if (digest_final(&ctx, entry->md5sum) == -1) {         //calcul de l'empreinte et stockage
+        close(fd);
         return -1;
     }
 
-    EVP_MD_CTX_free(mdctx);         //on libere la memoire
-    fclose(file);               //on ferme le fichier
+    close(fd);               //on ferme le fichier
 
-    return 0;
+    entry->md5_computed = true;
 
-    // (compilation avec gcc -o file-properties file-properties.c -lssl -lcrypto)
+    return 0;
 }
 
  
 
+/*!
+ * @brief ensure_file_md5 computes a file's MD5 sum, unless it has already been computed
+ * @param entry is a pointer to the files list entry
+ * @param cache is a pointer to the persistent hash cache, NULL if none is used
+ * @return -1 in case of error, 0 else
+ * A valid digest found in the cache is used as is; a computed digest is added to the cache.
+ */
+int ensure_file_md5(files_list_entry_t *entry, hash_cache_t *cache) {
+    if (!entry) {
+        return -1;
+    }
+    if (entry->md5_computed) {
+        return 0;
+    }
+    if (cache && hash_cache_lookup(cache, entry)) {         //fichier inchangé depuis le dernier calcul
+        return 0;
+    }
+    if (compute_file_md5(entry) == -1) {
+        return -1;
+    }
+    if (cache) {
+        hash_cache_store(cache, entry);
+    }
+    return 0;
+}
+
+/*!
+ * @brief read_small_file reads a whole small file into a buffer
+ * @param entry is the files list entry
+ * @param buffer is the buffer, of HASH_SMALL_FILE_SIZE bytes at least
+ * @return the size of the file, -1 if it cannot be read or is not small anymore
+ */
+static ssize_t read_small_file(files_list_entry_t *entry, uint8_t *buffer) {
+    int fd = open(entry->path_and_name, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+
+    size_t length = 0;
+    while (length < HASH_SMALL_FILE_SIZE) {
+        ssize_t bytes = read(fd, buffer + length, HASH_SMALL_FILE_SIZE - length);
+        if (bytes == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            close(fd);
+            return (bytes == 0) ? (ssize_t)length : -1;
+        }
+        length += bytes;
+    }
+    close(fd);
+    return -1;                  //le fichier a grossi : il sera haché seul
+}
+
+/*!
+ * @brief hash_small_files_batch hashes the small files read in a batch, with multi-buffer MD5
+ * @param batch are the entries of the files
+ * @param data are the contents of the files
+ * @param lengths are the sizes of the files
+ * @param count is the number of files in the batch
+ * @param cache is a pointer to the persistent hash cache, NULL if none is used
+ */
+static void hash_small_files_batch(files_list_entry_t **batch, const uint8_t **data, size_t *lengths, size_t count, hash_cache_t *cache) {
+    uint8_t digests[MD5_MB_BATCH_FILES][16];
+    md5_mb_digest(data, lengths, count, digests);
+    for (size_t i = 0; i < count; ++i) {
+        memcpy(batch[i]->md5sum, digests[i], sizeof(batch[i]->md5sum));
+        batch[i]->md5_computed = true;
+        if (cache) {
+            hash_cache_store(cache, batch[i]);
+        }
+    }
+}
+
+/*!
+ * @brief ensure_files_md5 computes the MD5 sums of many entries (@see ensure_file_md5)
+ * Small files are read in batches and hashed several at once with multi-buffer MD5 when the CPU has
+ * AVX2 or AVX-512; other files, or other digest algorithms, are hashed one by one.
+ * @param entries are the files list entries to hash
+ * @param count is the number of entries
+ * @param cache is a pointer to the persistent hash cache, NULL if none is used
+ * @return the number of entries that could not be hashed
+ */
+int ensure_files_md5(files_list_entry_t **entries, size_t count, hash_cache_t *cache) {
+    int errors = 0;
+    bool batched = files_digest_algorithm == DIGEST_MD5 && md5_mb_lanes() > 1;
+    uint8_t *buffer = batched ? malloc(MD5_MB_BATCH_BYTES) : NULL;
+
+    files_list_entry_t *batch[MD5_MB_BATCH_FILES];
+    const uint8_t *data[MD5_MB_BATCH_FILES];
+    size_t lengths[MD5_MB_BATCH_FILES];
+    size_t batch_count = 0;
+    size_t used = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        files_list_entry_t *entry = entries[i];
+        if (entry->md5_computed || (cache && hash_cache_lookup(cache, entry))) {
+            continue;
+        }
+
+        ssize_t length = -1;
+        if (buffer && entry->size < HASH_SMALL_FILE_SIZE) {
+            if (batch_count == MD5_MB_BATCH_FILES || MD5_MB_BATCH_BYTES - used < HASH_SMALL_FILE_SIZE) {   //lot plein
+                hash_small_files_batch(batch, data, lengths, batch_count, cache);
+                batch_count = 0;
+                used = 0;
+            }
+            length = read_small_file(entry, buffer + used);
+        }
+        if (length == -1) {                     //gros fichier, ou lecture à refaire seule
+            if (compute_file_md5(entry) == -1) {
+                errors++;
+            } else if (cache) {
+                hash_cache_store(cache, entry);
+            }
+            continue;
+        }
+
+        batch[batch_count] = entry;
+        data[batch_count] = buffer + used;
+        lengths[batch_count] = length;
+        batch_count++;
+        used += (length + 63) & ~(size_t)63;
+    }
+
+    if (batch_count > 0) {
+        hash_small_files_batch(batch, data, lengths, batch_count, cache);
+    }
+    free(buffer);
+    return errors;
+}
+
 /*!
  * @brief directory_exists tests the existence of a directory
  * @path_to_dir a string with the path to the directory
@@ -3,8 +3,24 @@
 #include "files-list.h"
 #include <stdbool.h>
 #include "configuration.h"
+#include "hash-cache.h"
+#include "digest.h"
 
+#define STATS_BATCH_SIZE 1024
+#define HASH_SMALL_FILE_SIZE (64 * 1024) // below: read through a stack buffer
+#define HASH_BUFFER_SIZE (1024 * 1024) // medium files: aligned read buffer
+#define HASH_BUFFER_ALIGNMENT 4096
+#define HASH_MMAP_THRESHOLD (1024 * 1024) // above: mmap
+#define TREE_HASH_MIN_SIZE (256ULL * 1024 * 1024) // above: tree hash, when enabled
+#define TREE_HASH_CHUNK_SIZE (64 * 1024 * 1024)
+
+void set_digest_algorithm(digest_algorithm_t algorithm);
+digest_algorithm_t get_digest_algorithm(void);
+void set_tree_hash_threads(int threads_count);
 int get_file_stats(files_list_entry_t *entry);
+int get_files_list_stats(files_list_t *list);
 int compute_file_md5(files_list_entry_t *entry);
+int ensure_file_md5(files_list_entry_t *entry, hash_cache_t *cache);
+int ensure_files_md5(files_list_entry_t **entries, size_t count, hash_cache_t *cache);
 bool directory_exists(char *path_to_dir);
 bool is_directory_writable(char *path_to_dir);
\ No newline at end of file
@@ -14,17 +14,81 @@ int compute_file_md5(files_list_entry_t *entry);
 */
 
 
+/*!
+ * @brief init_files_list initializes an empty files list
+ * @param list is a pointer to the list to be initialized
+ */
+void init_files_list(files_list_t *list) {
+    init_shared_files_list(list, NULL);
+}
+
+/*!
+ * @brief init_shared_files_list initializes an empty files list whose entries and paths are in a shared region
+ * The list can then be built by a process and used directly by another one (@see shared-region.h)
+ * @param list is a pointer to the list to be initialized
+ * @param region is the shared region (NULL for a private list)
+ */
+void init_shared_files_list(files_list_t *list, shared_region_t *region) {
+    list->head = list->tail = NULL;
+    init_shared_arena(&list->entries, 1024 * sizeof(files_list_entry_t), region);      //un slab contient 1024 entrées
+    init_shared_arena(&list->paths, 0, region);
+}
+
 /*!
  * @brief clear_files_list clears a files list
  * @param list is a pointer to the list to be cleared
- * This function is provided, you don't need to implement nor modify it
+ * Entries and paths are released all at once with the arenas of the list
  */
 void clear_files_list(files_list_t *list) {
-    while (list->head) {
-        files_list_entry_t *tmp = list->head;
-        list->head = tmp->next;
-        free(tmp);
+    list->head = list->tail = NULL;
+    clear_arena(&list->entries);
+    clear_arena(&list->paths);
+}
+
+/*!
+ * @brief new_file_entry allocates a blank entry from the slabs of a list
+ * The entry is not linked into the list, and it is released with the list (@see clear_files_list)
+ * @param list is the list that will own the entry
+ * @return a pointer to the entry (zeroed), NULL if out of memory
+ */
+files_list_entry_t *new_file_entry(files_list_t *list) {
+    if (!list) {
+        return NULL;
+    }
+
+    files_list_entry_t *new_entry = arena_alloc(&list->entries, sizeof(files_list_entry_t));
+    if (new_entry) {
+        memset(new_entry, 0, sizeof(files_list_entry_t));     //à zéro pour les champs non remplis des dossiers
+    }
+    return new_entry;
+}
+
+/*!
+ * @brief get_files_list_memory gets the memory counters of a list
+ * @param list is the list to inspect
+ * @param memory is a pointer to the counters to fill
+ */
+void get_files_list_memory(files_list_t *list, files_list_memory_t *memory) {
+    if (!list || !memory) {
+        return;
     }
+    memory->entries_count = list->entries.allocations_count;
+    memory->allocated_bytes = list->entries.allocated_bytes + list->paths.allocated_bytes;
+    memory->reserved_bytes = list->entries.reserved_bytes + list->paths.reserved_bytes;
+    memory->peak_reserved_bytes = list->entries.peak_reserved_bytes + list->paths.peak_reserved_bytes;
+}
+
+/*!
+ * @brief set_entry_path copies a path into the paths arena of a list and attaches it to an entry
+ * @param list is the list owning the entry
+ * @param entry is the entry whose path is set
+ * @param file_path is the path to copy
+ * @return 0 in case of success, -1 else (out of memory)
+ */
+static int set_entry_path(files_list_t *list, files_list_entry_t *entry, char *file_path) {
+    entry->path_length = strlen(file_path);
+    entry->path_and_name = arena_strndup(&list->paths, file_path, entry->path_length);
+    return entry->path_and_name ? 0 : -1;
 }
 
 /*!
@@ -44,17 +108,15 @@ files_list_entry_t *add_file_entry(files_list_t *list, char *file_path) {
     }
 
 
-    files_list_entry_t *new_entry = (files_list_entry_t *)malloc(sizeof(files_list_entry_t)); //allocation de la memoire
+    files_list_entry_t *new_entry = new_file_entry(list); //allocation de la memoire dans les slabs de la liste
 
     if (!new_entry) {               //si out of memory
-        printf("out of memory\n");
         return NULL;                    // NULL et pas -1 car doit retourner un pointeur
     }
 
-    
-
-    strcpy(new_entry->path_and_name, file_path);            //recuperation path and name
-    
+    if (set_entry_path(list, new_entry, file_path) == -1) {            //recuperation path and name
+        return NULL;
+    }
 
     files_list_entry_t *current = list->head;
 
@@ -78,7 +140,6 @@ files_list_entry_t *add_file_entry(files_list_t *list, char *file_path) {
         int result = add_entry_to_tail(list, new_entry);        // ajout en fin de liste
         if (result == -1) {
             printf("erreur dans l'ajout");
-            free(new_entry);
             return NULL;
         }
     }
@@ -89,12 +150,178 @@ files_list_entry_t *add_file_entry(files_list_t *list, char *file_path) {
 }
 
 
+/*!
+ *  @brief append_file_entry adds a new file at the end of the files list, without keeping it ordered
+ *  It is the builder mode of the list: entries are collected in any order, then the list is
+ *  ordered once with sort_files_list.
+ *  @param list the list to add the file entry into
+ *  @param file_path the full path (from the root of the considered tree) of the file
+ *  @return a pointer to the new entry, NULL else (out of memory)
+ */
+files_list_entry_t *append_file_entry(files_list_t *list, char *file_path) {
+
+    if (!list || !file_path) {
+        printf("Invalide parameter\n");
+        return NULL;
+    }
+
+    files_list_entry_t *new_entry = new_file_entry(list); //allocation de la memoire dans les slabs de la liste
+
+    if (!new_entry) {               //si out of memory
+        return NULL;
+    }
+
+    if (set_entry_path(list, new_entry, file_path) == -1) {            //recuperation path and name
+        return NULL;
+    }
+
+    add_entry_to_tail(list, new_entry);                     //pas de tri ici, voir sort_files_list
+
+    return new_entry;
+}
+
+/*!
+ * @brief char_at returns the byte of a path at a given depth, as compared by strcmp
+ */
+static inline int char_at(files_list_entry_t *entry, size_t depth) {
+    return (unsigned char)entry->path_and_name[depth];
+}
+
+/*!
+ * @brief sort_entries sorts an array of entries with a multikey (MSD radix) quicksort on the path bytes
+ * Entries are partitioned on their byte at position depth, then the equal part is sorted on the next byte.
+ * The resulting order is the strcmp order.
+ * @param entries is the array of entries to sort
+ * @param count is the number of entries in the array
+ * @param depth is the number of leading bytes all the entries are known to share
+ */
+static void sort_entries(files_list_entry_t **entries, size_t count, size_t depth) {
+    while (count > 1) {
+        if (count < 16) {                   //petits tableaux : tri par insertion
+            for (size_t i = 1; i < count; ++i) {
+                files_list_entry_t *current = entries[i];
+                size_t j = i;
+                while (j > 0 && strcmp(entries[j - 1]->path_and_name + depth, current->path_and_name + depth) > 0) {
+                    entries[j] = entries[j - 1];
+                    --j;
+                }
+                entries[j] = current;
+            }
+            return;
+        }
+
+        // pivot : médiane de trois pour éviter le pire cas sur les listes déjà triées
+        int a = char_at(entries[0], depth);
+        int b = char_at(entries[count / 2], depth);
+        int c = char_at(entries[count - 1], depth);
+        int pivot = (a < b) ? ((b < c) ? b : ((a < c) ? c : a)) : ((a < c) ? a : ((b < c) ? c : b));
+
+        // partition en 3 : [0, lt) < pivot, [lt, gt) == pivot, [gt, count) > pivot
+        size_t lt = 0, i = 0, gt = count;
+        while (i < gt) {
+            int ch = char_at(entries[i], depth);
+            if (ch < pivot) {
+                files_list_entry_t *tmp = entries[lt];
+                entries[lt++] = entries[i];
+                entries[i++] = tmp;
+            } else if (ch > pivot) {
+                files_list_entry_t *tmp = entries[--gt];
+                entries[gt] = entries[i];
+                entries[i] = tmp;
+            } else {
+                ++i;
+            }
+        }
+
+        sort_entries(entries, lt, depth);
+        sort_entries(entries + gt, count - gt, depth);
+
+        if (pivot == 0) {                   //fin des chaines : les entrées égales sont identiques
+            return;
+        }
+        entries += lt;                      //on continue sur l'octet suivant des entrées égales
+        count = gt - lt;
+        ++depth;
+    }
+}
+
+/*!
+ * @brief sort_files_list orders a files list (strcmp order on the paths) in one pass
+ * Entries are collected into an array, sorted with a MSD string sort, then linked back.
+ * @param list is a pointer to the list to sort
+ * @return 0 in case of success, -1 else (out of memory)
+ */
+int sort_files_list(files_list_t *list) {
+    if (!list) {
+        printf("Invalide parameter\n");
+        return -1;
+    }
+
+    size_t count = 0;
+    for (files_list_entry_t *cursor = list->head; cursor != NULL; cursor = cursor->next) {
+        ++count;
+    }
+    if (count < 2) {
+        return 0;
+    }
+
+    files_list_entry_t **entries = malloc(count * sizeof(files_list_entry_t *));
+    if (!entries) {
+        printf("out of memory\n");
+        return -1;
+    }
+
+    size_t i = 0;
+    for (files_list_entry_t *cursor = list->head; cursor != NULL; cursor = cursor->next) {
+        entries[i++] = cursor;
+    }
+
+    sort_entries(entries, count, 0);
+
+    for (i = 0; i < count; ++i) {           //on refait les liens dans le nouvel ordre
+        entries[i]->prev = (i > 0) ? entries[i - 1] : NULL;
+        entries[i]->next = (i + 1 < count) ? entries[i + 1] : NULL;
+    }
+    list->head = entries[0];
+    list->tail = entries[count - 1];
+
+    free(entries);
+    return 0;
+}
+
+/*!
+ * @brief merge_files_list moves all the entries of a list at the end of another one, without ordering
+ * The receiving list also takes the arenas of the other list, which is left empty.
+ * @param list is a pointer to the list receiving the entries
+ * @param other is a pointer to the list giving its entries
+ */
+void merge_files_list(files_list_t *list, files_list_t *other) {
+    if (!list || !other) {
+        printf("Invalide parameter\n");
+        return;
+    }
+
+    if (other->head) {
+        if (list->tail) {
+            list->tail->next = other->head;
+            other->head->prev = list->tail;
+        } else {
+            list->head = other->head;
+        }
+        list->tail = other->tail;
+    }
+    other->head = other->tail = NULL;
+
+    arena_adopt(&list->entries, &other->entries);
+    arena_adopt(&list->paths, &other->paths);
+}
+
 /*!
  * @brief add_entry_to_tail adds an entry directly to the tail of the list
  * It supposes that the entries are provided already ordered, e.g. when a lister process sends its list's
  * elements to the main process.
  * @param list is a pointer to the list to which to add the element
- * @param entry is a pointer to the entry to add. The list becomes owner of the entry.
+ * @param entry is a pointer to the entry to add, allocated with new_file_entry on the same list.
  * @return 0 in case of success, -1 else
  */
 int add_entry_to_tail(files_list_t *list, files_list_entry_t *entry) {
@@ -162,6 +389,20 @@ void display_files_list(files_list_t *list) {
     }
 }
 
+/*!
+ * @brief display_files_list_memory displays the memory counters of a files list
+ * @param list is the pointer to the list
+ */
+void display_files_list_memory(files_list_t *list) {
+    if (!list)
+        return;
+
+    files_list_memory_t memory;
+    get_files_list_memory(list, &memory);
+    printf("%zu entries, %zu bytes used, %zu bytes reserved (peak %zu)\n",
+           memory.entries_count, memory.allocated_bytes, memory.reserved_bytes, memory.peak_reserved_bytes);
+}
+
 /*!
  * @brief display_files_list_reversed displays a files list from the end to the beginning
  * @param list is the pointer to the list to be displayed
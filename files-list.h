@@ -1,20 +1,28 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <time.h>
 #include <sys/types.h>
+#include <stddef.h>
+#include "arena.h"
 
 
 
 typedef enum { FICHIER, DOSSIER } file_type_t;
 
 typedef struct _files_list_entry {
-  char path_and_name[4096];
+  char *path_and_name; // stored in the paths arena of the list
+  size_t path_length;
   struct timespec mtime;
   uint64_t size;
   uint8_t md5sum[16];
+  bool md5_computed; // MD5 is computed lazily, only when needed for a comparison
   file_type_t entry_type;
   mode_t mode;
+  dev_t dev; // identity and change time of the file, for the hash cache
+  ino_t inode;
+  struct timespec ctime;
   struct _files_list_entry *next;
   struct _files_list_entry *prev;
 } files_list_entry_t;
@@ -26,14 +34,31 @@ typedef struct _files_list_entry {
 typedef struct {
   struct _files_list_entry *head;
   struct _files_list_entry *tail;
+  arena_t entries; // slabs the entries are allocated from
+  arena_t paths; // storage of the paths of the entries
 } files_list_t;
 
+typedef struct {
+  size_t entries_count;
+  size_t allocated_bytes; // entries and paths
+  size_t reserved_bytes; // current slabs
+  size_t peak_reserved_bytes;
+} files_list_memory_t;
+
 
 
 
+void init_files_list(files_list_t *list);
+void init_shared_files_list(files_list_t *list, shared_region_t *region);
 void clear_files_list(files_list_t *list);
+files_list_entry_t *new_file_entry(files_list_t *list);
+void get_files_list_memory(files_list_t *list, files_list_memory_t *memory);
 files_list_entry_t *add_file_entry(files_list_t *list, char *file_path);
+files_list_entry_t *append_file_entry(files_list_t *list, char *file_path);
+int sort_files_list(files_list_t *list);
+void merge_files_list(files_list_t *list, files_list_t *other);
 int add_entry_to_tail(files_list_t *list, files_list_entry_t *entry);
 files_list_entry_t *find_entry_by_name(files_list_t *list, char *file_path, size_t start_of_src, size_t start_of_dest);
 void display_files_list(files_list_t *list);
 void display_files_list_reversed(files_list_t *list);
+void display_files_list_memory(files_list_t *list);
@@ -0,0 +1,272 @@
+#include "hash-cache.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Cache persistant des empreintes : un fichier binaire (en-tête + enregistrements de taille fixe triés
+// par (dev, inode)), chargé en une lecture. Un enregistrement n'est valable que si la taille, la date de
+// modification et la date de changement d'état (ctime) du fichier n'ont pas bougé, et le fichier entier
+// est ignoré s'il a été écrit avec une autre fonction d'empreinte ou un autre mode de hachage des gros fichiers.
+
+/*!
+ * @brief compare_records orders records by (dev, inode), for qsort and bsearch
+ */
+static int compare_records(const void *lhd, const void *rhd) {
+    const hash_cache_record_t *left = lhd;
+    const hash_cache_record_t *right = rhd;
+    if (left->dev != right->dev) {
+        return (left->dev < right->dev) ? -1 : 1;
+    }
+    if (left->inode != right->inode) {
+        return (left->inode < right->inode) ? -1 : 1;
+    }
+    return 0;
+}
+
+/*!
+ * @brief make_record builds the cache record of an entry (key and validity fields)
+ * @param entry is the files list entry
+ * @param record is a pointer to the record to fill (the digest is taken from the entry)
+ */
+static void make_record(files_list_entry_t *entry, hash_cache_record_t *record) {
+    memset(record, 0, sizeof(hash_cache_record_t));
+    record->dev = entry->dev;
+    record->inode = entry->inode;
+    record->size = entry->size;
+    record->mtime_sec = entry->mtime.tv_sec;
+    record->mtime_nsec = entry->mtime.tv_nsec;
+    record->ctime_sec = entry->ctime.tv_sec;
+    record->ctime_nsec = entry->ctime.tv_nsec;
+    memcpy(record->digest, entry->md5sum, sizeof(record->digest));
+}
+
+/*!
+ * @brief load_hash_cache loads a hash cache file
+ * A missing or invalid file gives an empty cache.
+ * @param cache is a pointer to the cache to initialize
+ * @param path is the path of the cache file
+ * @param algorithm is the digest algorithm of this run
+ * @param tree_chunk_size is the chunk size of the tree hashes of this run, 0 if they are not used
+ * @return 0 if all went good, -1 else (out of memory)
+ */
+int load_hash_cache(hash_cache_t *cache, char *path, digest_algorithm_t algorithm, uint32_t tree_chunk_size) {
+    memset(cache, 0, sizeof(hash_cache_t));
+    cache->algorithm = algorithm;
+    cache->tree_chunk_size = tree_chunk_size;
+    cache->path = strdup(path);
+    if (!cache->path) {
+        printf("out of memory\n");
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {                 //pas encore de cache
+        return 0;
+    }
+
+    struct stat stats;
+    hash_cache_header_t header;
+    if (fstat(fd, &stats) == -1 || read(fd, &header, sizeof(header)) != sizeof(header)
+        || memcmp(header.magic, HASH_CACHE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != HASH_CACHE_VERSION || header.record_size != sizeof(hash_cache_record_t)
+        || (uint64_t)stats.st_size != sizeof(header) + header.records_count * sizeof(hash_cache_record_t)) {
+        printf("Cache d'empreintes %s invalide, il est ignoré\n", path);
+        close(fd);
+        return 0;
+    }
+    if (header.digest_algorithm != (uint32_t)algorithm) {           //empreintes d'un autre algorithme
+        if (header.records_count > 0) {
+            printf("Cache d'empreintes %s calculé en %s, il est ignoré\n", path, digest_algorithm_name(header.digest_algorithm));
+        }
+        close(fd);
+        return 0;
+    }
+    if (header.tree_chunk_size != tree_chunk_size) {              //gros fichiers hachés autrement
+        if (header.records_count > 0) {
+            printf("Cache d'empreintes %s calculé avec un autre mode de hachage, il est ignoré\n", path);
+        }
+        close(fd);
+        return 0;
+    }
+
+    size_t bytes = header.records_count * sizeof(hash_cache_record_t);
+    cache->records = malloc(bytes ? bytes : 1);
+    cache->used = calloc(header.records_count ? header.records_count : 1, sizeof(bool));
+    if (!cache->records || !cache->used) {
+        printf("out of memory\n");
+        close(fd);
+        return -1;
+    }
+
+    size_t done = 0;
+    while (done < bytes) {                  //lecture de tous les enregistrements d'un coup
+        ssize_t result = read(fd, (char *)cache->records + done, bytes - done);
+        if (result <= 0) {
+            printf("Cache d'empreintes %s illisible, il est ignoré\n", path);
+            close(fd);
+            return 0;
+        }
+        done += result;
+    }
+    cache->count = header.records_count;
+
+    close(fd);
+    return 0;
+}
+
+/*!
+ * @brief hash_cache_lookup looks for a valid digest of an entry in the cache
+ * @param cache is a pointer to the cache
+ * @param entry is the files list entry; on a hit its md5sum is filled
+ * @return true on a hit, false else
+ */
+bool hash_cache_lookup(hash_cache_t *cache, files_list_entry_t *entry) {
+    hash_cache_record_t key;
+    make_record(entry, &key);
+
+    hash_cache_record_t *found = bsearch(&key, cache->records, cache->count, sizeof(hash_cache_record_t), compare_records);
+    if (!found || found->size != key.size || found->mtime_sec != key.mtime_sec || found->mtime_nsec != key.mtime_nsec
+        || found->ctime_sec != key.ctime_sec || found->ctime_nsec != key.ctime_nsec) {     //absent ou fichier modifié
+        cache->misses++;
+        return false;
+    }
+
+    memcpy(entry->md5sum, found->digest, sizeof(entry->md5sum));
+    entry->md5_computed = true;
+    cache->used[found - cache->records] = true;
+    cache->hits++;
+    return true;
+}
+
+/*!
+ * @brief hash_cache_store adds the digest of an entry to the cache
+ * @param cache is a pointer to the cache
+ * @param entry is the files list entry, whose md5sum has just been computed
+ * @return 0 if all went good, -1 else (out of memory)
+ */
+int hash_cache_store(hash_cache_t *cache, files_list_entry_t *entry) {
+    if (cache->added_count == cache->added_capacity) {
+        size_t new_capacity = cache->added_capacity ? cache->added_capacity * 2 : 256;
+        hash_cache_record_t *new_added = realloc(cache->added, new_capacity * sizeof(hash_cache_record_t));
+        if (!new_added) {
+            printf("out of memory\n");
+            return -1;
+        }
+        cache->added = new_added;
+        cache->added_capacity = new_capacity;
+    }
+
+    make_record(entry, &cache->added[cache->added_count++]);
+    return 0;
+}
+
+/*!
+ * @brief write_all writes a whole buffer, looping on partial writes
+ * @return 0 if all went good, -1 else
+ */
+static int write_all(int fd, const void *buffer, size_t size) {
+    const char *cursor = buffer;
+    while (size > 0) {
+        ssize_t result = write(fd, cursor, size);
+        if (result <= 0) {
+            return -1;
+        }
+        cursor += result;
+        size -= result;
+    }
+    return 0;
+}
+
+/*!
+ * @brief save_hash_cache writes the cache file (atomically: temporary file, then rename)
+ * Only the records used or computed during this run are kept, so that deleted files are pruned.
+ * @param cache is a pointer to the cache
+ * @return 0 if all went good, -1 else
+ */
+int save_hash_cache(hash_cache_t *cache) {
+    if (!cache->path || (cache->added_count == 0 && cache->misses == 0 && cache->hits == 0)) {
+        return 0;                   //cache pas utilisé : le fichier reste tel quel
+    }
+
+    size_t total = cache->added_count;
+    for (size_t i = 0; i < cache->count; ++i) {
+        total += cache->used[i];
+    }
+
+    hash_cache_record_t *records = malloc((total ? total : 1) * sizeof(hash_cache_record_t));
+    if (!records) {
+        printf("out of memory\n");
+        return -1;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < cache->added_count; ++i) {       //les nouveaux d'abord : ils priment
+        records[count++] = cache->added[i];
+    }
+    for (size_t i = 0; i < cache->count; ++i) {
+        if (cache->used[i]) {
+            records[count++] = cache->records[i];
+        }
+    }
+    qsort(records, count, sizeof(hash_cache_record_t), compare_records);     //qsort n'est pas stable : doublons traités ci-dessous
+
+    size_t unique = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (unique > 0 && compare_records(&records[unique - 1], &records[i]) == 0) {
+            continue;               //même fichier : une seule entrée (les deux sont valides pour ce run)
+        }
+        records[unique++] = records[i];
+    }
+
+    size_t path_length = strlen(cache->path);
+    char *tmp_path = malloc(path_length + sizeof(HASH_CACHE_TMP_SUFFIX));
+    if (!tmp_path) {
+        free(records);
+        return -1;
+    }
+    memcpy(tmp_path, cache->path, path_length);
+    memcpy(tmp_path + path_length, HASH_CACHE_TMP_SUFFIX, sizeof(HASH_CACHE_TMP_SUFFIX));
+
+    int result = -1;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd != -1) {
+        hash_cache_header_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, HASH_CACHE_MAGIC, sizeof(header.magic));
+        header.version = HASH_CACHE_VERSION;
+        header.record_size = sizeof(hash_cache_record_t);
+        header.digest_algorithm = cache->algorithm;
+        header.tree_chunk_size = cache->tree_chunk_size;
+        header.records_count = unique;
+
+        bool written = write_all(fd, &header, sizeof(header)) == 0
+            && write_all(fd, records, unique * sizeof(hash_cache_record_t)) == 0;
+        if (close(fd) == 0 && written) {            //une seule fermeture, quel que soit le résultat
+            result = rename(tmp_path, cache->path);
+        }
+        if (result == -1) {
+            unlink(tmp_path);
+        }
+    }
+    if (result == -1) {
+        printf("Erreur lors de l'écriture du cache d'empreintes %s\n", cache->path);
+    }
+
+    free(tmp_path);
+    free(records);
+    return result;
+}
+
+/*!
+ * @brief clear_hash_cache releases the memory of a cache
+ * @param cache is a pointer to the cache
+ */
+void clear_hash_cache(hash_cache_t *cache) {
+    free(cache->path);
+    free(cache->records);
+    free(cache->used);
+    free(cache->added);
+    memset(cache, 0, sizeof(hash_cache_t));
+}
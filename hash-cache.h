@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "files-list.h"
+#include "digest.h"
+
+#define HASH_CACHE_MAGIC "LP25HC\0"
+#define HASH_CACHE_VERSION 2
+#define HASH_CACHE_DEFAULT_NAME ".lp25-hash-cache"
+#define HASH_CACHE_TMP_SUFFIX ".tmp" // written there, then renamed over the cache
+
+typedef struct {
+    uint64_t dev;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ctime_sec;
+    int64_t ctime_nsec;
+    uint8_t digest[16];
+} hash_cache_record_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t digest_algorithm; // digests of another algorithm are never reused
+    uint32_t tree_chunk_size; // chunk size of the tree hashes of large files, 0 if not used
+    uint64_t records_count;
+} hash_cache_header_t;
+
+typedef struct {
+    char *path;
+    digest_algorithm_t algorithm;
+    uint32_t tree_chunk_size;
+    hash_cache_record_t *records; // loaded from the file, sorted by (dev, inode)
+    bool *used; // records hit during this run
+    size_t count;
+    hash_cache_record_t *added; // records computed during this run
+    size_t added_count;
+    size_t added_capacity;
+    size_t hits;
+    size_t misses;
+} hash_cache_t;
+
+int load_hash_cache(hash_cache_t *cache, char *path, digest_algorithm_t algorithm, uint32_t tree_chunk_size);
+bool hash_cache_lookup(hash_cache_t *cache, files_list_entry_t *entry);
+int hash_cache_store(hash_cache_t *cache, files_list_entry_t *entry);
+int save_hash_cache(hash_cache_t *cache);
+void clear_hash_cache(hash_cache_t *cache);
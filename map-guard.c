@@ -0,0 +1,68 @@
+#define _GNU_SOURCE
+#include "map-guard.h"
+#include <signal.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+
+// Lecture protégée des fichiers projetés en mémoire : si le fichier est tronqué pendant la lecture,
+// l'accès aux pages au-delà de sa nouvelle fin lève SIGBUS, qui tuerait le processus. Pendant qu'un
+// thread lit une projection, SIGBUS le ramène à son sigsetjmp ; hors d'une lecture protégée, le
+// signal garde son effet par défaut.
+
+static _Thread_local map_guard_t *active_guard = NULL;
+static pthread_once_t handler_once = PTHREAD_ONCE_INIT;
+static int handler_result = -1;
+
+/*!
+ * @brief sigbus_handler jumps back to the guard of the thread, or restores the default action
+ */
+static void sigbus_handler(int signal_number, siginfo_t *info, void *context) {
+    (void)context;
+    map_guard_t *guard = active_guard;
+    if (guard && info->si_code == BUS_ADRERR) {     //page au-delà de la fin du fichier
+        active_guard = guard->previous;
+        siglongjmp(guard->env, 1);
+    }
+    signal(signal_number, SIG_DFL);             //autre cause : l'instruction est rejouée sans gestionnaire
+}
+
+/*!
+ * @brief install_handler installs the SIGBUS handler, once for the whole process
+ */
+static void install_handler(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = sigbus_handler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    handler_result = sigaction(SIGBUS, &action, NULL);
+    if (handler_result == -1) {
+        printf("Erreur lors de l'installation du gestionnaire de SIGBUS\n");
+    }
+}
+
+/*!
+ * @brief map_guard_enter protects the reads of the calling thread from SIGBUS
+ * sigsetjmp(guard->env, 1) must have been called just before, in the function doing the reads.
+ * @param guard is a pointer to the guard
+ * @return 0 if all went good, -1 else (the mapping must not be read)
+ */
+int map_guard_enter(map_guard_t *guard) {
+    pthread_once(&handler_once, install_handler);
+    if (handler_result == -1) {
+        return -1;
+    }
+    guard->previous = active_guard;
+    active_guard = guard;
+    return 0;
+}
+
+/*!
+ * @brief map_guard_leave ends the protection started by map_guard_enter
+ * It must not be called after a jump back to the guard (the guard is already left).
+ * @param guard is a pointer to the guard
+ */
+void map_guard_leave(map_guard_t *guard) {
+    active_guard = guard->previous;
+}
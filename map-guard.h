@@ -0,0 +1,14 @@
+#pragma once
+
+#include <setjmp.h>
+#include <stdbool.h>
+
+// Usage: if (sigsetjmp(guard.env, 1) != 0) { file truncated: leave, unmap, fail }
+//        map_guard_enter(&guard); ...reads of the mapping... map_guard_leave(&guard);
+typedef struct _map_guard {
+    sigjmp_buf env; // where SIGBUS jumps back to
+    struct _map_guard *previous; // enclosing guard of the thread
+} map_guard_t;
+
+int map_guard_enter(map_guard_t *guard);
+void map_guard_leave(map_guard_t *guard);
@@ -0,0 +1,210 @@
+#include "md5-mb.h"
+#include <openssl/evp.h>
+#include <string.h>
+#include <stdbool.h>
+
+// MD5 multi-flux : 8 (AVX2) ou 16 (AVX-512) messages indépendants sont hachés en même temps, un message
+// par voie des registres vectoriels. Quand un message se termine, sa voie reprend le message suivant.
+// Sans AVX2, chaque message est haché par libcrypto (choix fait à l'exécution).
+
+static const uint32_t md5_constants[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const uint32_t md5_iv[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+typedef uint32_t md5_v8_t __attribute__((vector_size(32)));
+typedef uint32_t md5_v16_t __attribute__((vector_size(64)));
+
+typedef void (*md5_mb_kernel_t)(uint32_t state[4][MD5_MB_MAX_LANES], const uint8_t *const blocks[MD5_MB_MAX_LANES]);
+
+/*
+ * Compression d'un bloc de 64 octets par voie. Les mots du message sont transposés (mot j de chaque voie
+ * dans le vecteur m[j]), puis les 64 étapes de MD5 sont faites sur les vecteurs.
+ */
+#define MD5_STEP(f, a, b, c, d, word, i, shift)                                                  \
+    do {                                                                                        \
+        vector_t sum = a + (f) + md5_constants[i] + m[word];                                    \
+        a = b + ((sum << (shift)) | (sum >> (32 - (shift))));                                   \
+    } while (0)
+
+#define MD5_ROUNDS                                                                              \
+    _Pragma("GCC unroll 16") for (int i = 0; i < 16; i += 4) {                                  \
+        MD5_STEP(d ^ (b & (c ^ d)), a, b, c, d, i, i, 7);                                       \
+        MD5_STEP(c ^ (a & (b ^ c)), d, a, b, c, i + 1, i + 1, 12);                              \
+        MD5_STEP(b ^ (d & (a ^ b)), c, d, a, b, i + 2, i + 2, 17);                              \
+        MD5_STEP(a ^ (c & (d ^ a)), b, c, d, a, i + 3, i + 3, 22);                              \
+    }                                                                                           \
+    _Pragma("GCC unroll 16") for (int i = 16; i < 32; i += 4) {                                 \
+        MD5_STEP(c ^ (d & (b ^ c)), a, b, c, d, (5 * i + 1) % 16, i, 5);                        \
+        MD5_STEP(b ^ (c & (a ^ b)), d, a, b, c, (5 * i + 6) % 16, i + 1, 9);                    \
+        MD5_STEP(a ^ (b & (d ^ a)), c, d, a, b, (5 * i + 11) % 16, i + 2, 14);                  \
+        MD5_STEP(d ^ (a & (c ^ d)), b, c, d, a, (5 * i + 16) % 16, i + 3, 20);                  \
+    }                                                                                           \
+    _Pragma("GCC unroll 16") for (int i = 32; i < 48; i += 4) {                                 \
+        MD5_STEP(b ^ c ^ d, a, b, c, d, (3 * i + 5) % 16, i, 4);                                \
+        MD5_STEP(a ^ b ^ c, d, a, b, c, (3 * i + 8) % 16, i + 1, 11);                           \
+        MD5_STEP(d ^ a ^ b, c, d, a, b, (3 * i + 11) % 16, i + 2, 16);                          \
+        MD5_STEP(c ^ d ^ a, b, c, d, a, (3 * i + 14) % 16, i + 3, 23);                          \
+    }                                                                                           \
+    _Pragma("GCC unroll 16") for (int i = 48; i < 64; i += 4) {                                 \
+        MD5_STEP(c ^ (b | ~d), a, b, c, d, (7 * i) % 16, i, 6);                                 \
+        MD5_STEP(b ^ (a | ~c), d, a, b, c, (7 * i + 7) % 16, i + 1, 10);                        \
+        MD5_STEP(a ^ (d | ~b), c, d, a, b, (7 * i + 14) % 16, i + 2, 15);                       \
+        MD5_STEP(d ^ (c | ~a), b, c, d, a, (7 * i + 21) % 16, i + 3, 21);                       \
+    }
+
+#define MD5_MB_KERNEL(name, isa, type, width)                                                   \
+    __attribute__((target(isa))) static void name(uint32_t state[4][MD5_MB_MAX_LANES],          \
+                                                  const uint8_t *const blocks[MD5_MB_MAX_LANES]) { \
+        typedef type vector_t;                                                                  \
+        uint32_t words[16][width];                                                              \
+        for (int lane = 0; lane < width; ++lane) {                                              \
+            for (int j = 0; j < 16; ++j) {                                                      \
+                memcpy(&words[j][lane], blocks[lane] + 4 * j, sizeof(uint32_t));                \
+            }                                                                                   \
+        }                                                                                       \
+        vector_t m[16];                                                                         \
+        memcpy(m, words, sizeof(m));                                                            \
+        vector_t a, b, c, d;                                                                    \
+        memcpy(&a, state[0], sizeof(a));                                                        \
+        memcpy(&b, state[1], sizeof(b));                                                        \
+        memcpy(&c, state[2], sizeof(c));                                                        \
+        memcpy(&d, state[3], sizeof(d));                                                        \
+        vector_t a0 = a, b0 = b, c0 = c, d0 = d;                                                \
+        MD5_ROUNDS                                                                              \
+        a += a0;                                                                                \
+        b += b0;                                                                                \
+        c += c0;                                                                                \
+        d += d0;                                                                                \
+        memcpy(state[0], &a, sizeof(a));                                                       \
+        memcpy(state[1], &b, sizeof(b));                                                       \
+        memcpy(state[2], &c, sizeof(c));                                                        \
+        memcpy(state[3], &d, sizeof(d));                                                        \
+    }
+
+MD5_MB_KERNEL(md5_mb_kernel_avx2, "avx2", md5_v8_t, 8)
+MD5_MB_KERNEL(md5_mb_kernel_avx512, "avx512f", md5_v16_t, 16)
+
+typedef struct {
+    const uint8_t *data; // message of the lane, NULL if the lane is idle
+    size_t message; // index of the message in the batch
+    size_t full_blocks; // blocks read directly from the message
+    size_t total_blocks; // with the padding blocks
+    size_t block; // next block to compress
+    uint8_t tail[128]; // last bytes of the message with the padding
+} md5_lane_t;
+
+/*!
+ * @brief md5_mb_lanes gives the number of messages hashed at once on this CPU
+ * @return 16 with AVX-512, 8 with AVX2, 1 else (scalar hashing by libcrypto)
+ */
+int md5_mb_lanes(void) {
+    static int lanes = 0;
+    if (lanes == 0) {                           //détection faite une seule fois
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            lanes = 16;
+        } else if (__builtin_cpu_supports("avx2")) {
+            lanes = 8;
+        } else {
+            lanes = 1;
+        }
+    }
+    return lanes;
+}
+
+/*!
+ * @brief start_lane assigns a message to a lane and prepares its padding blocks
+ */
+static void start_lane(md5_lane_t *lane, uint32_t state[4][MD5_MB_MAX_LANES], int index, const uint8_t *data, size_t length, size_t message) {
+    size_t rest = length % 64;
+    lane->data = data;
+    lane->message = message;
+    lane->full_blocks = length / 64;
+    lane->total_blocks = lane->full_blocks + ((rest < 56) ? 1 : 2);
+    lane->block = 0;
+
+    memset(lane->tail, 0, sizeof(lane->tail));
+    memcpy(lane->tail, data + lane->full_blocks * 64, rest);
+    lane->tail[rest] = 0x80;
+    uint64_t bits = (uint64_t)length * 8;
+    memcpy(lane->tail + (lane->total_blocks - lane->full_blocks) * 64 - 8, &bits, sizeof(bits));   //x86 : petit-boutiste
+
+    for (int i = 0; i < 4; ++i) {
+        state[i][index] = md5_iv[i];
+    }
+}
+
+/*!
+ * @brief md5_mb_digest computes the MD5 sums of many messages at once
+ * @param data are the messages
+ * @param lengths are the lengths of the messages
+ * @param count is the number of messages
+ * @param digests receive the MD5 sums, identical to EVP_md5 ones
+ */
+void md5_mb_digest(const uint8_t *const *data, const size_t *lengths, size_t count, uint8_t (*digests)[16]) {
+    int width = md5_mb_lanes();
+    if (width == 1) {                           //pas de SIMD : une empreinte à la fois
+        for (size_t i = 0; i < count; ++i) {
+            EVP_Digest(data[i], lengths[i], digests[i], NULL, EVP_md5(), NULL);
+        }
+        return;
+    }
+    md5_mb_kernel_t kernel = (width == 16) ? md5_mb_kernel_avx512 : md5_mb_kernel_avx2;
+
+    static const uint8_t idle_block[64];
+    md5_lane_t lanes[MD5_MB_MAX_LANES];
+    uint32_t state[4][MD5_MB_MAX_LANES] = {{0}};    //voies inutilisées comprises : le noyau les calcule aussi
+    const uint8_t *blocks[MD5_MB_MAX_LANES];
+    size_t next = 0;
+    int active = 0;
+
+    for (int i = 0; i < width; ++i) {
+        lanes[i].data = NULL;
+        if (next < count) {
+            start_lane(&lanes[i], state, i, data[next], lengths[next], next);
+            next++;
+            active++;
+        }
+    }
+
+    while (active > 0) {
+        for (int i = 0; i < width; ++i) {
+            md5_lane_t *lane = &lanes[i];
+            if (!lane->data) {
+                blocks[i] = idle_block;         //voie inutilisée : résultat ignoré
+            } else if (lane->block < lane->full_blocks) {
+                blocks[i] = lane->data + lane->block * 64;
+            } else {
+                blocks[i] = lane->tail + (lane->block - lane->full_blocks) * 64;
+            }
+        }
+
+        kernel(state, blocks);
+
+        for (int i = 0; i < width; ++i) {
+            md5_lane_t *lane = &lanes[i];
+            if (!lane->data || ++lane->block < lane->total_blocks) {
+                continue;
+            }
+            for (int j = 0; j < 4; ++j) {       //message terminé : empreinte puis message suivant
+                memcpy(digests[lane->message] + 4 * j, &state[j][i], sizeof(uint32_t));
+            }
+            lane->data = NULL;
+            active--;
+            if (next < count) {
+                start_lane(lane, state, i, data[next], lengths[next], next);
+                next++;
+                active++;
+            }
+        }
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MD5_MB_MAX_LANES 16
+#define MD5_MB_BATCH_FILES 256 // files read before a batch is hashed
+#define MD5_MB_BATCH_BYTES (4 * 1024 * 1024) // bytes read before a batch is hashed
+
+int md5_mb_lanes(void);
+void md5_mb_digest(const uint8_t *const *data, const size_t *lengths, size_t count, uint8_t (*digests)[16]);
@@ -1,45 +1,149 @@
 #include "messages.h"
-#include <sys/msg.h>
 #include <string.h>
+#include <stddef.h>
 
 #include <stdio.h>
 
 // Functions in this file are required for inter processes communication
 
+_Static_assert(sizeof(any_message_t) <= TRANSPORT_MESSAGE_SIZE, "messages must fit the slots of the rings");
+
+static shared_region_t *messages_region = NULL; // region of the entries designated by the messages
+
+/*!
+ * @brief set_messages_region sets the shared region where the entries of the messages are, before forking
+ * @param region is a pointer to the region
+ */
+void set_messages_region(shared_region_t *region) {
+    messages_region = region;
+}
+
+/*!
+ * @brief get_message_entry gives the entry designated by a received message, in the shared region
+ * @param msg is the received message
+ * @return a pointer to the entry, NULL for an invalid index
+ */
+files_list_entry_t *get_message_entry(files_list_entry_transmit_t *msg) {
+    return shared_region_at(messages_region, msg->index);
+}
+
+/*!
+ * @brief get_message_list gives the list designated by an end of list message, in the shared region
+ * @param msg is the received message
+ * @return a pointer to the list, NULL for an invalid index
+ */
+files_list_t *get_message_list(files_list_entry_transmit_t *msg) {
+    return shared_region_at(messages_region, msg->index);
+}
+
+/*!
+ * @brief get_message_entries gives the entries designated by a received batch message, in the shared region
+ * @param msg is the received message
+ * @param entries is an array of MESSAGE_BATCH_MAX_ENTRIES pointers, filled with the entries
+ * @return the number of entries (invalid indices are skipped: fewer than msg->count then)
+ */
+size_t get_message_entries(files_list_batch_transmit_t *msg, files_list_entry_t **entries) {
+    size_t count = 0;
+    for (size_t i = 0; i < msg->count && i < MESSAGE_BATCH_MAX_ENTRIES; ++i) {
+        files_list_entry_t *entry = shared_region_at(messages_region, msg->indices[i]);
+        if (entry) {
+            entries[count++] = entry;
+        }
+    }
+    return count;
+}
+
+/*!
+ * @brief receive_message waits for the next message of a topic
+ * @param transport is a pointer to the transport of the messages
+ * @param recipient is the topic to listen to (as transport_receive's recipient, so negative values get several topics)
+ * @param msg is the message to fill
+ * @return the size of the message (after the mtype), -1 in case of error
+ */
+ssize_t receive_message(transport_t *transport, long recipient, any_message_t *msg) {
+    ssize_t result = transport_receive(transport, recipient, msg, sizeof(any_message_t) - sizeof(long));
+
+    if (result == -1) {
+        printf("erreur lors de la réception d'un message\n");
+    }
+    return result;
+}
+
 /*!
  * @brief send_file_entry sends a file entry, with a given command code
- * @param msg_queue the MQ identifier through which to send the entry
+ * @param transport is a pointer to the transport of the messages
  * @param recipient is the id of the recipient (as specified by mtype)
  * @param file_entry is a pointer to the entry to send (must be copied)
  * @param cmd_code is the cmd code to process the entry.
- * @return the result of the msgsnd function
+ * @return the result of the transport_send function
  * Used by the specialized functions send_analyze*
+ * The entry must be in the shared region (@see set_messages_region): only its index is sent.
  */
-int send_file_entry(int msg_queue, int recipient, files_list_entry_t *file_entry, int cmd_code) {
+int send_file_entry(transport_t *transport, int recipient, files_list_entry_t *file_entry, int cmd_code) {
     any_message_t msg; //utilisation du type defini 
     
-    msg.list_entry.reply_to = msg_queue;//id d'un message
+    msg.list_entry.reply_to = transport->msg_queue;//id d'un message
     msg.list_entry.mtype = recipient;//type de message
-    msg.list_entry.payload = *file_entry; 
     msg.list_entry.op_code = cmd_code; 
-    // au final cela utiliser la struct files_list_entry_transmit_t en passant par any_message_t  
+    msg.list_entry.index = shared_region_index(messages_region, file_entry);       //l'entrée reste dans la mémoire partagée
+    if (msg.list_entry.index == SHARED_INDEX_NONE) {
+        printf("Entrée hors de la mémoire partagée\n");
+        return -1;
+    }
 
-    int result = msgsnd(msg_queue, &msg, sizeof(any_message_t) - sizeof(long), 0); //envoie du message
-     if (result == -1) {    //gestion d'erreur
+    int result = transport_send(transport, &msg, sizeof(files_list_entry_transmit_t) - sizeof(long)); //envoie du message
+    if (result == -1) {    //gestion d'erreur
         printf("erreur\n");
     }
 
     return result; 
 }
 
+/*!
+ * @brief send_file_entries sends a batch of file entries in one message, with a given command code
+ * @param transport is a pointer to the transport of the messages
+ * @param recipient is the id of the recipient (as specified by mtype)
+ * @param entries is an array of pointers to the entries to send (in the shared region)
+ * @param count is the number of entries, at most MESSAGE_BATCH_MAX_ENTRIES (0 for an empty batch)
+ * @param cmd_code is the cmd code to process the entries
+ * @return the result of the transport_send function
+ * Only the used indices are sent (@see send_file_entry).
+ */
+int send_file_entries(transport_t *transport, int recipient, files_list_entry_t **entries, size_t count, int cmd_code) {
+    if ((!entries && count > 0) || count > MESSAGE_BATCH_MAX_ENTRIES) {        //un lot vide reste une réponse valide
+        printf("Invalid parameters\n");
+        return -1;
+    }
+
+    any_message_t msg;
+    msg.list_batch.mtype = recipient;
+    msg.list_batch.op_code = cmd_code;
+    msg.list_batch.reply_to = transport->msg_queue;
+    msg.list_batch.count = count;
+    for (size_t i = 0; i < count; ++i) {
+        msg.list_batch.indices[i] = shared_region_index(messages_region, entries[i]);
+        if (msg.list_batch.indices[i] == SHARED_INDEX_NONE) {
+            printf("Entrée hors de la mémoire partagée\n");
+            return -1;
+        }
+    }
+
+    size_t length = offsetof(files_list_batch_transmit_t, indices) + count * sizeof(uint64_t) - sizeof(long);     //taille variable
+    int result = transport_send(transport, &msg, length);
+    if (result == -1) {
+        printf("erreur\n");
+    }
+    return result;
+}
+
 /*!
  * @brief send_analyze_dir_command sends a command to analyze a directory
- * @param msg_queue is the id of the MQ used to send the command
+ * @param transport is a pointer to the transport of the messages
  * @param recipient is the recipient of the message (mtype)
  * @param target_dir is a string containing the path to the directory to analyze
- * @return the result of msgsnd
+ * @return the result of transport_send
  */
-int send_analyze_dir_command(int msg_queue, int recipient, char *target_dir) {
+int send_analyze_dir_command(transport_t *transport, int recipient, char *target_dir) {
 
     any_message_t msg;
     msg.analyze_dir_command.mtype = recipient;   
@@ -48,8 +152,9 @@ int send_analyze_dir_command(int msg_queue, int recipient, char *target_dir) {
 
     strncpy(msg.analyze_dir_command.target, target_dir, PATH_SIZE - 1);//copie du chemin
     msg.analyze_dir_command.target[PATH_SIZE - 1] = '\0'; //pour etre sur que le chemin ce fini 
+    size_t length = offsetof(analyze_dir_command_t, target) + strlen(msg.analyze_dir_command.target) + 1 - sizeof(long);
    
-    int result = msgsnd(msg_queue, &msg, sizeof(analyze_dir_command_t) - sizeof(long), 0); // envoie du message
+    int result = transport_send(transport, &msg, length); // envoie du message
 
     if (result == -1) {     //gestion d'erreur
         printf("erreur\n");
@@ -63,52 +168,93 @@ int send_analyze_dir_command(int msg_queue, int recipient, char *target_dir) {
 
 /*!
  * @brief send_analyze_file_command sends a file entry to be analyzed
- * @param msg_queue the MQ identifier through which to send the entry
+ * @param transport is a pointer to the transport of the messages
  * @param recipient is the id of the recipient (as specified by mtype)
  * @param file_entry is a pointer to the entry to send (must be copied)
  * @return the result of the send_file_entry function
  * Calls send_file_entry function
  */
-int send_analyze_file_command(int msg_queue, int recipient, files_list_entry_t *file_entry) {
-    return send_file_entry(msg_queue, recipient, file_entry, COMMAND_CODE_ANALYZE_FILE); //COMMAND_CODE_ANALYZE_FILE indique qu'on doit analyser le fichier
+int send_analyze_file_command(transport_t *transport, int recipient, files_list_entry_t *file_entry) {
+    return send_file_entry(transport, recipient, file_entry, COMMAND_CODE_ANALYZE_FILE); //COMMAND_CODE_ANALYZE_FILE indique qu'on doit analyser le fichier
 }
 
 /*!
  * @brief send_analyze_file_response sends a file entry after analyze
- * @param msg_queue the MQ identifier through which to send the entry
+ * @param transport is a pointer to the transport of the messages
  * @param recipient is the id of the recipient (as specified by mtype)
  * @param file_entry is a pointer to the entry to send (must be copied)
  * @return the result of the send_file_entry function
  * Calls send_file_entry function
  */
-int send_analyze_file_response(int msg_queue, int recipient, files_list_entry_t *file_entry) {
-    return send_file_entry(msg_queue, recipient, file_entry, COMMAND_CODE_FILE_ANALYZED);  //COMMAND_CODE_FILE_ANALYZED indique que le ficheir envoyer est analyser
+int send_analyze_file_response(transport_t *transport, int recipient, files_list_entry_t *file_entry) {
+    return send_file_entry(transport, recipient, file_entry, COMMAND_CODE_FILE_ANALYZED);  //COMMAND_CODE_FILE_ANALYZED indique que le ficheir envoyer est analyser
 }
 
 /*!
  * @brief send_files_list_element sends a files list entry from a complete files list
- * @param msg_queue the MQ identifier through which to send the entry
+ * @param transport is a pointer to the transport of the messages
  * @param recipient is the id of the recipient (as specified by mtype)
  * @param file_entry is a pointer to the entry to send (must be copied)
  * @return the result of the send_file_entry function
  * Calls send_file_entry function
  */
-int send_files_list_element(int msg_queue, int recipient, files_list_entry_t *file_entry) {
-    return send_file_entry(msg_queue, recipient, file_entry, COMMAND_CODE_FILE_ENTRY ); //COMMAND_CODE_FILE_ENTRY  indique que'il s'agit d'un files list entry
+int send_files_list_element(transport_t *transport, int recipient, files_list_entry_t *file_entry) {
+    return send_file_entry(transport, recipient, file_entry, COMMAND_CODE_FILE_ENTRY ); //COMMAND_CODE_FILE_ENTRY  indique que'il s'agit d'un files list entry
+}
+
+// Batch variants of the 3 functions above
+
+/*!
+ * @brief send_analyze_files_command sends a batch of file entries to be analyzed
+ * @param transport is a pointer to the transport of the messages
+ * @param recipient is the id of the recipient (as specified by mtype)
+ * @param entries is an array of pointers to the entries to send
+ * @param count is the number of entries
+ * @return the result of the send_file_entries function
+ */
+int send_analyze_files_command(transport_t *transport, int recipient, files_list_entry_t **entries, size_t count) {
+    return send_file_entries(transport, recipient, entries, count, COMMAND_CODE_ANALYZE_FILES);
+}
+
+/*!
+ * @brief send_analyze_files_response sends a batch of file entries after analyze
+ * @param transport is a pointer to the transport of the messages
+ * @param recipient is the id of the recipient (as specified by mtype)
+ * @param entries is an array of pointers to the entries to send
+ * @param count is the number of entries
+ * @return the result of the send_file_entries function
+ */
+int send_analyze_files_response(transport_t *transport, int recipient, files_list_entry_t **entries, size_t count) {
+    return send_file_entries(transport, recipient, entries, count, COMMAND_CODE_FILES_ANALYZED);
+}
+
+/*!
+ * @brief send_files_list_elements sends a batch of files list entries from a complete files list
+ * @param transport is a pointer to the transport of the messages
+ * @param recipient is the id of the recipient (as specified by mtype)
+ * @param entries is an array of pointers to the entries to send
+ * @param count is the number of entries
+ * @return the result of the send_file_entries function
+ */
+int send_files_list_elements(transport_t *transport, int recipient, files_list_entry_t **entries, size_t count) {
+    return send_file_entries(transport, recipient, entries, count, COMMAND_CODE_FILES_ENTRIES);
 }
 
 /*!
  * @brief send_list_end sends the end of list message to the main process
- * @param msg_queue is the id of the MQ used to send the message
+ * @param transport is a pointer to the transport of the messages
  * @param recipient is the destination of the message
- * @return the result of msgsnd
+ * @param list is the list, in the shared region (NULL if it could not be allocated)
+ * @param complete is false when the list misses entries: the main process must not use it
+ * @return the result of transport_send
  */
-int send_list_end(int msg_queue, int recipient) {
+int send_list_end(transport_t *transport, int recipient, files_list_t *list, bool complete) {
     any_message_t msg;
-    msg.simple_command.mtype = recipient;
-    msg.simple_command.message = COMMAND_CODE_LIST_COMPLETE;// indique que c'est la fin puisques la list est complete
-    //reviens a utiliser la struct simple_command_t
-    int result = msgsnd(msg_queue, &msg, sizeof(simple_command_t) - sizeof(long), 0);//envoie du message
+    msg.list_entry.mtype = recipient;
+    msg.list_entry.op_code = (complete && list) ? COMMAND_CODE_LIST_COMPLETE : COMMAND_CODE_LIST_FAILED;// indique que c'est la fin, et si la liste est complete
+    msg.list_entry.reply_to = transport->msg_queue;
+    msg.list_entry.index = shared_region_index(messages_region, list);      //le processus principal reprend la liste telle quelle
+    int result = transport_send(transport, &msg, sizeof(files_list_entry_transmit_t) - sizeof(long));//envoie du message
     
     if (result == -1) {
         printf("erreur");   //cas d'echec
@@ -120,16 +266,16 @@ int send_list_end(int msg_queue, int recipient) {
 
 /*!
  * @brief send_terminate_command sends a terminate command to a child process so it stops
- * @param msg_queue is the MQ id used to send the command
+ * @param transport is a pointer to the transport of the messages
  * @param recipient is the target of the terminate command
- * @return the result of msgsnd
+ * @return the result of transport_send
  */
-int send_terminate_command(int msg_queue, int recipient) {
+int send_terminate_command(transport_t *transport, int recipient) {
     any_message_t msg;
     msg.simple_command.mtype = recipient;
     msg.simple_command.message = COMMAND_CODE_TERMINATE;//inquique que c'est un terminate command
     //reviens a utiliser la struct simple_command_t
-    int result = msgsnd(msg_queue, &msg, sizeof(simple_command_t) - sizeof(long), 0);//envoie du message
+    int result = transport_send(transport, &msg, sizeof(simple_command_t) - sizeof(long));//envoie du message
 
     if (result == -1) {
         printf("erreur \n");    //cas d'erreur
@@ -140,16 +286,16 @@ int send_terminate_command(int msg_queue, int recipient) {
 
 /*!
  * @brief send_terminate_confirm sends a terminate confirmation from a child process to the requesting parent.
- * @param msg_queue is the id of the MQ used to send the message
+ * @param transport is a pointer to the transport of the messages
  * @param recipient is the destination of the message
- * @return the result of msgsnd
+ * @return the result of transport_send
  */
-int send_terminate_confirm(int msg_queue, int recipient) {
+int send_terminate_confirm(transport_t *transport, int recipient) {
     any_message_t msg;
     msg.simple_command.mtype = recipient;
     msg.simple_command.message = COMMAND_CODE_TERMINATE_OK;//indique que c'est un terminate confiramation
 
-    int result = msgsnd(msg_queue, &msg, sizeof(simple_command_t) - sizeof(long), 0); //envoie message
+    int result = transport_send(transport, &msg, sizeof(simple_command_t) - sizeof(long)); //envoie message
 
     if (result == -1) {
         printf("erreur");   //cas d'erreur
@@ -2,6 +2,8 @@
 
 #include "files-list.h"
 #include "defines.h"
+#include "shared-region.h"
+#include "transport.h"
 
 #define COMMAND_CODE_TERMINATE 0x0
 #define COMMAND_CODE_TERMINATE_OK 0x10
@@ -10,49 +12,73 @@
 #define COMMAND_CODE_ANALYZE_DIR 0x02
 #define COMMAND_CODE_FILE_ENTRY 0x12
 #define COMMAND_CODE_LIST_COMPLETE 0x22
+#define COMMAND_CODE_LIST_FAILED 0x42 // end of a list the lister could not build entirely
+#define COMMAND_CODE_ANALYZE_FILES 0x03 // batches of entries
+#define COMMAND_CODE_FILES_ANALYZED 0x13
+#define COMMAND_CODE_FILES_ENTRIES 0x32
+#define COMMAND_CODE_ANALYZE_FAILED 0x43 // answer to a request whose entries could not all be found in the shared region
 
+#define MESSAGE_BATCH_MAX_ENTRIES 64 // entries per batch message (8 bytes each)
+#define MESSAGE_BATCH_MIN_ENTRIES 1
+
+// The main process listens to two topics, so that a single receive (with -MSG_TYPE_TO_MAIN_DESTINATION)
+// gets the messages about both lists while telling them apart
 #define MSG_TYPE_TO_MAIN 1
-#define MSG_TYPE_TO_SOURCE_LISTER 2
-#define MSG_TYPE_TO_DESTINATION_LISTER 3
-#define MSG_TYPE_TO_SOURCE_ANALYZERS 4
-#define MSG_TYPE_TO_DESTINATION_ANALYZERS 5
+#define MSG_TYPE_TO_MAIN_DESTINATION 2
+#define MSG_TYPE_TO_SOURCE_LISTER 3
+#define MSG_TYPE_TO_DESTINATION_LISTER 4
+#define MSG_TYPE_TO_SOURCE_ANALYZERS 5
+#define MSG_TYPE_TO_DESTINATION_ANALYZERS 6
 
 typedef struct {
     long mtype;
     char message;
 } simple_command_t;
 
+// Entries live in the shared region mapped before the processes are forked (@see prepare):
+// messages only carry their index there, never their content
 typedef struct {
     long mtype;
-    char op_code; // Contains the analyze file opcode
-    files_list_entry_t payload;
-} analyze_file_command_t;
+    char op_code; // Contains the analyze file, file analyzed, list complete or list failed opcode
+    int reply_to; // MQ id of the sender (-1 with the rings)
+    uint64_t index; // index of the entry (of the files_list_t for the list complete) in the shared region
+} files_list_entry_transmit_t;
 
 typedef struct {
     long mtype;
-    char op_code; // Contains the analyze file opcode
-    files_list_entry_t payload;
-    int reply_to; // MQ id of the sender, to build either source or destination list
-} files_list_entry_transmit_t;
+    char op_code; // Contains the analyze files, files analyzed, analyze failed or files entries opcode
+    int reply_to; // MQ id of the sender (-1 with the rings)
+    uint16_t count; // number of indices
+    uint64_t indices[MESSAGE_BATCH_MAX_ENTRIES]; // only count indices are sent
+} files_list_batch_transmit_t;
 
 typedef struct {
     long mtype;
     char op_code; // Contains the analyze dir opcode
-    char target[PATH_SIZE];
+    char target[PATH_SIZE]; // only the used bytes are sent
 } analyze_dir_command_t;
 
 typedef union {
     simple_command_t simple_command;
-    analyze_file_command_t analyze_file_command;
     analyze_dir_command_t analyze_dir_command;
     files_list_entry_transmit_t list_entry;
+    files_list_batch_transmit_t list_batch;
 } any_message_t;
 
-int send_analyze_dir_command(int msg_queue, int recipient, char *target_dir);
-int send_file_entry(int msg_queue, int recipient, files_list_entry_t *file_entry, int cmd_code);
-int send_analyze_file_command(int msg_queue, int recipient, files_list_entry_t *file_entry);
-int send_analyze_file_response(int msg_queue, int recipient, files_list_entry_t *file_entry);
-int send_files_list_element(int msg_queue, int recipient, files_list_entry_t *file_entry);
-int send_list_end(int msg_queue, int recipient);
-int send_terminate_command(int msg_queue, int recipient);
-int send_terminate_confirm(int msg_queue, int recipient);
\ No newline at end of file
+ssize_t receive_message(transport_t *transport, long recipient, any_message_t *msg);
+void set_messages_region(shared_region_t *region);
+files_list_entry_t *get_message_entry(files_list_entry_transmit_t *msg);
+files_list_t *get_message_list(files_list_entry_transmit_t *msg);
+size_t get_message_entries(files_list_batch_transmit_t *msg, files_list_entry_t **entries);
+int send_analyze_dir_command(transport_t *transport, int recipient, char *target_dir);
+int send_file_entry(transport_t *transport, int recipient, files_list_entry_t *file_entry, int cmd_code);
+int send_analyze_file_command(transport_t *transport, int recipient, files_list_entry_t *file_entry);
+int send_analyze_file_response(transport_t *transport, int recipient, files_list_entry_t *file_entry);
+int send_files_list_element(transport_t *transport, int recipient, files_list_entry_t *file_entry);
+int send_file_entries(transport_t *transport, int recipient, files_list_entry_t **entries, size_t count, int cmd_code);
+int send_analyze_files_command(transport_t *transport, int recipient, files_list_entry_t **entries, size_t count);
+int send_analyze_files_response(transport_t *transport, int recipient, files_list_entry_t **entries, size_t count);
+int send_files_list_elements(transport_t *transport, int recipient, files_list_entry_t **entries, size_t count);
+int send_list_end(transport_t *transport, int recipient, files_list_t *list, bool complete);
+int send_terminate_command(transport_t *transport, int recipient);
+int send_terminate_confirm(transport_t *transport, int recipient);
\ No newline at end of file
@@ -1,17 +1,35 @@
 #include "processes.h"
 #include <stdlib.h>
 #include <unistd.h>
-#include <sys/msg.h>
 #include <stdio.h>
 #include "messages.h"
 #include "file-properties.h"
 #include "sync.h"
 #include <string.h>
 #include <errno.h>
+#include "walker.h"
 
 #include <sys/wait.h>
+/*!
+ * @brief analyzers_per_list gives the number of analyzers of each list (-n option)
+ * @param the_config is a pointer to the program configuration
+ * @return the number of analyzers for the source, and for the destination
+ */
+static int analyzers_per_list(configuration_t *the_config) {
+    int count = the_config->processes_count;
+    if (count < 1) {
+        count = 1;
+    } else if (count > MAX_ANALYZERS_PER_LIST) {        //le nombre de processus tient sur 8 bits
+        count = MAX_ANALYZERS_PER_LIST;
+    }
+    return count;
+}
+
 /*!
  * @brief prepare prepares (only when parallel is enabled) the processes used for the synchronization.
+ * It creates the MQ, a lister for the source and one for the destination, and -n analyzers for each of them.
+ * In PARALLEL_THREADS mode, it only starts -n analyzer threads in the main process.
+ * If something fails, the parallel mode is disabled and the synchronization runs in the main process.
  * @param the_config is a pointer to the program configuration
  * @param p_context is a pointer to the program processes context
  * @return 0 if all went good, -1 else
@@ -19,27 +37,76 @@
 int prepare(configuration_t *the_config, process_context_t *p_context) {
     if (the_config == NULL || !the_config->is_parallel) {  //on verifie qu'on est bien en parallele et que la configuration est valide
         return 0; //sinon on retourne 0
-    } else {
-        key_t mq_key = ftok(".", 'M'); //on cree la cle pour la file de messages 
-        int message_queue_id = msgget(mq_key, IPC_CREAT | 0666); //creation de la file pour la communication entre les processus
-        if (message_queue_id == -1) { //verification des erreurs
-            printf("Erreur lors de la création de la file de messages");
-            return -1;
-        }
+    }
 
-        pid_t source_lister_pid = fork(); //on cree le processus en verifiant les erreurs
-        if (source_lister_pid == -1) {
-            printf("Erreur lors de la création du processus source lister");
+    int analyzers_count = analyzers_per_list(the_config);
+    memset(p_context, 0, sizeof(process_context_t));
+    p_context->main_process_pid = getpid();
+    if (the_config->parallel_mode == PARALLEL_THREADS) {        //pas de fork : un thread par analyseur (-n)
+        p_context->uses_threads = true;
+        if (init_analyzer_pool(&p_context->analyzers, the_config->processes_count) == -1) {
+            the_config->is_parallel = false;
             return -1;
-        } else if (source_lister_pid == 0) { //on execute la fonction pour le processus fils
-            lister_process_loop(p_context); 
-            exit(0); 
         }
-        p_context->message_queue_id = message_queue_id; //mise a jour du nouveau contexte des processus
-        p_context->source_lister_pid = source_lister_pid;
-
         return 0;
     }
+    if (init_shared_region(&p_context->entries_region, SHARED_REGION_SIZE) == -1) {      //les listes y sont construites
+        the_config->is_parallel = false;
+        return -1;
+    }
+    set_messages_region(&p_context->entries_region);
+    if (init_transport(&p_context->transport, the_config->transport, &p_context->entries_region) == -1) { //file de messages privée ou anneaux partagés
+        printf("Erreur lors de la création du transport des messages\n");
+        clear_shared_region(&p_context->entries_region);
+        the_config->is_parallel = false;
+        return -1;
+    }
+
+    p_context->source_analyzers_pids = calloc(analyzers_count, sizeof(pid_t));
+    p_context->destination_analyzers_pids = calloc(analyzers_count, sizeof(pid_t));
+    if (!p_context->source_analyzers_pids || !p_context->destination_analyzers_pids) {
+        printf("out of memory\n");
+        free(p_context->source_analyzers_pids);
+        free(p_context->destination_analyzers_pids);
+        clear_transport(&p_context->transport);
+        clear_shared_region(&p_context->entries_region);
+        the_config->is_parallel = false;
+        return -1;
+    }
+
+    lister_configuration_t source_lister = {
+        .my_recipient_id = MSG_TYPE_TO_SOURCE_ANALYZERS,
+        .my_receiver_id = MSG_TYPE_TO_SOURCE_LISTER,
+        .analyzers_count = analyzers_count,
+        .list_recipient_id = MSG_TYPE_TO_MAIN,
+        .walker_threads = the_config->walker_threads,
+        .region = &p_context->entries_region,
+        .transport = &p_context->transport,
+    };
+    lister_configuration_t destination_lister = source_lister;
+    destination_lister.my_recipient_id = MSG_TYPE_TO_DESTINATION_ANALYZERS;
+    destination_lister.my_receiver_id = MSG_TYPE_TO_DESTINATION_LISTER;
+    destination_lister.list_recipient_id = MSG_TYPE_TO_MAIN_DESTINATION;
+
+    analyzer_configuration_t source_analyzer = {
+        .my_recipient_id = MSG_TYPE_TO_SOURCE_LISTER,
+        .my_receiver_id = MSG_TYPE_TO_SOURCE_ANALYZERS,
+        .transport = &p_context->transport,
+        .use_md5 = the_config->uses_md5,
+    };
+    analyzer_configuration_t destination_analyzer = source_analyzer;
+    destination_analyzer.my_recipient_id = MSG_TYPE_TO_DESTINATION_LISTER;
+    destination_analyzer.my_receiver_id = MSG_TYPE_TO_DESTINATION_ANALYZERS;
+
+    fflush(stdout);                             //sinon les fils réécriraient le tampon du parent
+    p_context->source_lister_pid = make_process(p_context, lister_process_loop, &source_lister);
+    p_context->destination_lister_pid = make_process(p_context, lister_process_loop, &destination_lister);
+    for (int i = 0; i < analyzers_count; ++i) {
+        p_context->source_analyzers_pids[i] = make_process(p_context, analyzer_process_loop, &source_analyzer);
+        p_context->destination_analyzers_pids[i] = make_process(p_context, analyzer_process_loop, &destination_analyzer);
+    }
+
+    return 0;
 }
 
 /*!
@@ -66,22 +133,153 @@ int make_process(process_context_t *p_context, process_loop_t func, void *parame
 
 }
 
+/*!
+ * @brief wait_analyzed_entry waits for the next analyzer response (the entry is already updated in the shared region)
+ * @param transport is a pointer to the transport of the messages
+ * @param cfg is a pointer to the lister configuration
+ * @return 0 if a response was received, 1 if the response tells that entries were not analyzed, -1 if none was received
+ */
+static int wait_analyzed_entry(transport_t *transport, lister_configuration_t *cfg) {
+    any_message_t msg;
+    do {
+        if (receive_message(transport, cfg->my_receiver_id, &msg) == -1) {
+            return -1;
+        }
+    } while (msg.list_entry.op_code != COMMAND_CODE_FILE_ANALYZED && msg.list_entry.op_code != COMMAND_CODE_FILES_ANALYZED
+             && msg.list_entry.op_code != COMMAND_CODE_ANALYZE_FAILED);      //seules les réponses sont attendues ici
+    return (msg.list_entry.op_code == COMMAND_CODE_ANALYZE_FAILED) ? 1 : 0;
+}
+
+/*!
+ * @brief adapt_batch_size adapts the number of entries per request to the depth of the analyzers' queue
+ * Requests still waiting mean the analyzers are busy: larger batches, so fewer messages. An empty queue
+ * means analyzers may be idle: smaller batches reach them sooner.
+ * @param transport is a pointer to the transport of the messages
+ * @param cfg is a pointer to the lister configuration
+ * @param batch_size is the current number of entries per request
+ * @return the new number of entries per request
+ */
+static size_t adapt_batch_size(transport_t *transport, lister_configuration_t *cfg, size_t batch_size) {
+    ssize_t depth = transport_depth(transport, cfg->my_recipient_id);
+    if (depth > 0 && batch_size < MESSAGE_BATCH_MAX_ENTRIES) {
+        batch_size *= 2;
+    } else if (depth == 0 && batch_size > MESSAGE_BATCH_MIN_ENTRIES) {
+        batch_size /= 2;
+    }
+    return (batch_size > MESSAGE_BATCH_MAX_ENTRIES) ? MESSAGE_BATCH_MAX_ENTRIES : batch_size;
+}
+
 /*!
  * @brief lister_process_loop is the lister process function (@see make_process)
+ * For each directory to analyze, it walks the tree into a list of the shared region, hands the entries to
+ * the analyzers by batches (at most one request in flight per analyzer), then sends the list itself to the main process.
  * @param parameters is a pointer to its parameters, to be cast to a lister_configuration_t
  */
 void lister_process_loop(void *parameters) {
     lister_configuration_t *config = (lister_configuration_t *)parameters; //cast des paramètre vers lister_configuration_t 
+    transport_t *transport = config->transport;
 
+    any_message_t msg;
+    while (receive_message(transport, config->my_receiver_id, &msg) != -1) {
+        if (msg.simple_command.message == COMMAND_CODE_TERMINATE) {
+            send_terminate_confirm(transport, MSG_TYPE_TO_MAIN);
+            break;
+        }
+        if (msg.analyze_dir_command.op_code != COMMAND_CODE_ANALYZE_DIR) {
+            continue;
+        }
 
+        files_list_t *list = shared_region_alloc(config->region, sizeof(files_list_t), _Alignof(files_list_t));
+        if (!list) {
+            printf("Mémoire partagée épuisée pour la liste de %s\n", msg.analyze_dir_command.target);
+            send_list_end(transport, config->list_recipient_id, NULL, false);      //le processus principal la refait lui-même
+            continue;
+        }
+        init_shared_files_list(list, config->region);          //entrées et chemins dans la mémoire partagée
+        if (walk_tree(list, msg.analyze_dir_command.target, config->walker_threads) == -1) {   //l'ordre est rétabli par le processus principal
+            printf("erreur dans le parcours de %s\n", msg.analyze_dir_command.target);
+            send_list_end(transport, config->list_recipient_id, list, false);      //liste partielle : pas d'analyse
+            continue;
+        }
+
+        files_list_entry_t *batch[MESSAGE_BATCH_MAX_ENTRIES];
+        size_t batch_count = 0;
+        size_t batch_size = MESSAGE_BATCH_MIN_ENTRIES;
+        int current_analyzers = 0;
+        bool analyzed = true;                   //faux dès qu'un lot n'a pas été envoyé ou analysé entièrement
+        for (files_list_entry_t *cursor = list->head; cursor != NULL && analyzed; cursor = cursor->next) {
+            batch[batch_count++] = cursor;
+            if (batch_count >= batch_size) {
+                if (request_elements_details(transport, batch, batch_count, config, &current_analyzers) == -1) {
+                    analyzed = false;
+                }
+                batch_count = 0;
+                batch_size = adapt_batch_size(transport, config, batch_size);
+            }
+        }
+        if (analyzed && batch_count > 0 && request_elements_details(transport, batch, batch_count, config, &current_analyzers) == -1) {
+            analyzed = false;
+        }
+        while (current_analyzers > 0) {         //dernières réponses, attendues même après un échec
+            int result = wait_analyzed_entry(transport, config);
+            if (result == -1) {
+                analyzed = false;
+                break;
+            }
+            if (result == 1) {
+                analyzed = false;
+            }
+            current_analyzers--;
+        }
+        send_list_end(transport, config->list_recipient_id, list, analyzed);        //la liste appartient désormais au processus principal
+    }
 }
 
 /*!
  * @brief analyzer_process_loop is the analyzer process function
+ * It gets the metadata of the entries it receives (alone or by batches), in place in the shared region, and answers its lister.
+ * Digests are not computed here: make_diff_list computes them only for the files it must compare (with the hash cache).
  * @param parameters is a pointer to its parameters, to be cast to an analyzer_configuration_t
  */
 void analyzer_process_loop(void *parameters) {
     analyzer_configuration_t *config = (analyzer_configuration_t *)parameters; //cast des paramètre vers lister_configuration_t  analyzer_configuration_t 
+    transport_t *transport = config->transport;
+
+    any_message_t msg;
+    while (receive_message(transport, config->my_receiver_id, &msg) != -1) {
+        if (msg.simple_command.message == COMMAND_CODE_TERMINATE) {
+            send_terminate_confirm(transport, MSG_TYPE_TO_MAIN);
+            break;
+        }
+        if (msg.list_batch.op_code == COMMAND_CODE_ANALYZE_FILES) {
+            files_list_entry_t *entries[MESSAGE_BATCH_MAX_ENTRIES];
+            size_t count = get_message_entries(&msg.list_batch, entries);
+            for (size_t i = 0; i < count; ++i) {
+                if (get_file_stats(entries[i]) == -1) {
+                    printf("erreur dans l'obtention des stats de %s\n", entries[i]->path_and_name);
+                }
+            }
+            if (count < msg.list_batch.count) {         //indice invalide : la liste serait incomplète
+                send_file_entries(transport, config->my_recipient_id, entries, count, COMMAND_CODE_ANALYZE_FAILED);
+            } else {
+                send_analyze_files_response(transport, config->my_recipient_id, entries, count);     //attendue même si le lot est vide
+            }
+            continue;
+        }
+        if (msg.list_entry.op_code != COMMAND_CODE_ANALYZE_FILE) {
+            continue;
+        }
+
+        files_list_entry_t *entry = get_message_entry(&msg.list_entry);
+        if (!entry) {                           //le listeur attend quand même une réponse
+            send_file_entries(transport, config->my_recipient_id, NULL, 0, COMMAND_CODE_ANALYZE_FAILED);
+            continue;
+        }
+        if (get_file_stats(entry) == -1) {      //l'entrée est gardée quand même, comme en mode séquentiel
+            printf("erreur dans l'obtention des stats de %s\n", entry->path_and_name);
+        }
+        send_analyze_file_response(transport, config->my_recipient_id, entry);
+    }
 }
 
 /*!
@@ -91,30 +289,101 @@ void analyzer_process_loop(void *parameters) {
  */
 void clean_processes(configuration_t *the_config, process_context_t *p_context) {
     // Do nothing if not parallel
-     if (!the_config->is_parallel) {
+    if (!the_config->is_parallel) {
         return;
     }
-    // Send terminate
+    if (p_context->uses_threads) {
+        clear_analyzer_pool(&p_context->analyzers);
+        return;
+    }
+    transport_t *transport = &p_context->transport;
+    int analyzers_count = analyzers_per_list(the_config);
 
-     for (int i = 0; i < p_context->processes_count; ++i) { //boucle pour récuprer chaque pid
-        int pid = p_context->destination_analyzers_pids[i]; //recupere le pid stocker
-        if (pid > 0) { //si c'est un pid valide
-            send_terminate_command(p_context->message_queue_id, pid); //appel de la fonction pour send terminate
-        }
+    // Send terminate
+    send_terminate_command(transport, MSG_TYPE_TO_SOURCE_LISTER);
+    send_terminate_command(transport, MSG_TYPE_TO_DESTINATION_LISTER);
+    for (int i = 0; i < analyzers_count; ++i) {         //chaque analyseur consomme une commande
+        send_terminate_command(transport, MSG_TYPE_TO_SOURCE_ANALYZERS);
+        send_terminate_command(transport, MSG_TYPE_TO_DESTINATION_ANALYZERS);
     }
 
     // Wait for responses
-
-    for (int i = 0; i < p_context->processes_count; ++i) { //boucle pour récuprer chaque pid
-        int pid = p_context->destination_analyzers_pids[i];//recupere le pid stocker
-        if (pid > 0) {  //si c'est un pid valide
-            int status; //pour recuperer le statut du processus fini
-            waitpid(pid, &status, 0);//attente que le pid ce fini
+    any_message_t msg;
+    for (int confirmed = 0; confirmed < p_context->processes_count;) {
+        if (receive_message(transport, MSG_TYPE_TO_MAIN, &msg) == -1) {
+            break;
+        }
+        if (msg.simple_command.message == COMMAND_CODE_TERMINATE_OK) {
+            confirmed++;
         }
     }
 
+    waitpid(p_context->source_lister_pid, NULL, 0);
+    waitpid(p_context->destination_lister_pid, NULL, 0);
+    for (int i = 0; i < analyzers_count; ++i) {
+        waitpid(p_context->source_analyzers_pids[i], NULL, 0);
+        waitpid(p_context->destination_analyzers_pids[i], NULL, 0);
+    }
+
     // Free allocated memory
     free(p_context->source_analyzers_pids);
-     // Free the MQ
-    msgctl(p_context->message_queue_id, IPC_RMID,NULL);
+    free(p_context->destination_analyzers_pids);
+    // Free the MQ (the rings are released with the shared region)
+    clear_transport(transport);
+    clear_shared_region(&p_context->entries_region);
+}
+
+/*!
+ * @brief request_element_details sends an entry to the analyzers, once one of them is free
+ * While all the analyzers are busy, it waits for their responses.
+ * @param transport is a pointer to the transport of the messages
+ * @param entry is the entry to analyze
+ * @param cfg is a pointer to the lister configuration
+ * @param current_analyzers is a pointer to the number of requests in flight
+ * @return 0 if the entry was sent, -1 if it was not or if a response tells that entries were not analyzed
+ */
+int request_element_details(transport_t *transport, files_list_entry_t *entry, lister_configuration_t *cfg, int *current_analyzers) {
+    bool failed = false;
+    while (*current_analyzers >= cfg->analyzers_count) {       //tous les analyseurs sont occupés
+        int result = wait_analyzed_entry(transport, cfg);
+        if (result == -1) {
+            return -1;
+        }
+        failed = failed || result == 1;
+        (*current_analyzers)--;
+    }
+
+    if (send_analyze_file_command(transport, cfg->my_recipient_id, entry) == -1) {
+        return -1;
+    }
+    (*current_analyzers)++;
+    return failed ? -1 : 0;
+}
+
+/*!
+ * @brief request_elements_details sends a batch of entries to the analyzers, once one of them is free
+ * (@see request_element_details)
+ * @param transport is a pointer to the transport of the messages
+ * @param entries is an array of pointers to the entries to analyze
+ * @param count is the number of entries, at most MESSAGE_BATCH_MAX_ENTRIES
+ * @param cfg is a pointer to the lister configuration
+ * @param current_analyzers is a pointer to the number of requests in flight
+ * @return 0 if the batch was sent, -1 if it was not or if a response tells that entries were not analyzed
+ */
+int request_elements_details(transport_t *transport, files_list_entry_t **entries, size_t count, lister_configuration_t *cfg, int *current_analyzers) {
+    bool failed = false;
+    while (*current_analyzers >= cfg->analyzers_count) {       //tous les analyseurs sont occupés
+        int result = wait_analyzed_entry(transport, cfg);
+        if (result == -1) {
+            return -1;
+        }
+        failed = failed || result == 1;
+        (*current_analyzers)--;
+    }
+
+    if (send_analyze_files_command(transport, cfg->my_recipient_id, entries, count) == -1) {
+        return -1;
+    }
+    (*current_analyzers)++;
+    return failed ? -1 : 0;
 }
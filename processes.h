@@ -4,8 +4,13 @@
 #include <sys/ipc.h>
 #include <sys/types.h>
 #include "files-list.h"
+#include "shared-region.h"
+#include "transport.h"
+#include "analyzer-pool.h"
 #include <stdbool.h>
 
+#define MAX_ANALYZERS_PER_LIST 64 // largest -n accepted, processes_count fits its 8 bits
+
 typedef struct {
     uint8_t processes_count;
     pid_t main_process_pid;
@@ -13,21 +18,26 @@ typedef struct {
     pid_t destination_lister_pid;
     pid_t *source_analyzers_pids;
     pid_t *destination_analyzers_pids;
-    key_t shared_key;
-    int message_queue_id;
+    transport_t transport; // messages between the processes
+    shared_region_t entries_region; // entries of both lists, mapped before forking
+    bool uses_threads; // PARALLEL_THREADS: no child process, the analyzers are threads
+    analyzer_pool_t analyzers; // PARALLEL_THREADS
 } process_context_t;
 
 typedef struct {
     int my_recipient_id; // Id of analyzers' MQ topic
     int my_receiver_id; // Id of MQ topic to listen to
     int analyzers_count; // Number of analyzers available
-    key_t mq_key;
+    int list_recipient_id; // Id of the main process' MQ topic for this list
+    int walker_threads; // Threads walking the directory
+    shared_region_t *region; // where the list is built
+    transport_t *transport;
 } lister_configuration_t;
 
 typedef struct {
     int my_recipient_id; // Id of my lister
     int my_receiver_id; // Id I must listen to
-    key_t mq_key;
+    transport_t *transport;
     bool use_md5; // Set to true when computing MD5sum for files
 } analyzer_configuration_t;
 
@@ -38,4 +48,5 @@ int make_process(process_context_t *p_context, process_loop_t func, void *parame
 void lister_process_loop(void *parameters);
 void analyzer_process_loop(void *parameters);
 void clean_processes(configuration_t *the_config, process_context_t *p_context);
-void request_element_details(int msg_queue, files_list_entry_t *entry, lister_configuration_t *cfg, int *current_analyzers);
\ No newline at end of file
+int request_element_details(transport_t *transport, files_list_entry_t *entry, lister_configuration_t *cfg, int *current_analyzers);
+int request_elements_details(transport_t *transport, files_list_entry_t **entries, size_t count, lister_configuration_t *cfg, int *current_analyzers);
\ No newline at end of file
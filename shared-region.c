@@ -0,0 +1,126 @@
+#define _GNU_SOURCE
+#include "shared-region.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+// Zone de mémoire partagée (memfd) projetée avant les fork : les listeurs, les analyseurs et le
+// processus principal y voient les mêmes objets à la même adresse, les pointeurs y restent donc valides.
+// L'allocation avance un compteur atomique placé au début de la zone ; rien n'est libéré avant la fin.
+
+typedef struct {
+    atomic_uint_least64_t used; // bytes allocated, header included
+} shared_region_header_t;
+
+/*!
+ * @brief init_shared_region creates and maps a shared region, to be done before forking
+ * When the size cannot be mapped, smaller sizes are tried down to SHARED_REGION_MIN_SIZE.
+ * @param region is a pointer to the region to initialize
+ * @param size is the wanted size of the region
+ * @return 0 if all went good, -1 else
+ */
+int init_shared_region(shared_region_t *region, size_t size) {
+    memset(region, 0, sizeof(shared_region_t));
+    region->fd = memfd_create("lp25-entries", MFD_CLOEXEC);
+    if (region->fd == -1) {
+        printf("Erreur lors de la création de la mémoire partagée\n");
+        return -1;
+    }
+
+    for (; size >= SHARED_REGION_MIN_SIZE; size /= 2) {        //espace d'adressage limité : on réduit
+        if (ftruncate(region->fd, size) == -1) {
+            continue;
+        }
+        void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, region->fd, 0);
+        if (base != MAP_FAILED) {
+            region->base = base;
+            region->size = size;
+            break;
+        }
+    }
+    if (!region->base) {
+        printf("Erreur lors de la projection de la mémoire partagée\n");
+        close(region->fd);
+        region->fd = -1;
+        return -1;
+    }
+
+    shared_region_header_t *header = (shared_region_header_t *)region->base;
+    atomic_init(&header->used, sizeof(shared_region_header_t));
+    return 0;
+}
+
+/*!
+ * @brief shared_region_alloc allocates memory from a shared region, from any process or thread
+ * @param region is a pointer to the region
+ * @param size is the number of bytes to allocate
+ * @param alignment is the required alignment (a power of 2)
+ * @return a pointer to the allocated memory, NULL if the region is full
+ * The memory is only released with the region (@see clear_shared_region)
+ */
+void *shared_region_alloc(shared_region_t *region, size_t size, size_t alignment) {
+    if (!region || !region->base) {
+        return NULL;
+    }
+
+    shared_region_header_t *header = (shared_region_header_t *)region->base;
+    uint64_t used = atomic_load(&header->used);
+    uint64_t offset;
+    do {
+        offset = (used + alignment - 1) & ~(uint64_t)(alignment - 1);
+        if (offset + size > region->size) {
+            printf("shared region full\n");
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak(&header->used, &used, offset + size));
+
+    return region->base + offset;
+}
+
+/*!
+ * @brief shared_region_index gives the position of an object in a shared region, to be sent to another process
+ * @param region is a pointer to the region
+ * @param pointer is a pointer to the object (in the region)
+ * @return the index of the object, SHARED_INDEX_NONE if pointer is NULL or out of the region
+ */
+uint64_t shared_region_index(shared_region_t *region, void *pointer) {
+    char *address = (char *)pointer;
+    if (!region || !address || address < region->base || address >= region->base + region->size) {
+        return SHARED_INDEX_NONE;
+    }
+    return address - region->base;
+}
+
+/*!
+ * @brief shared_region_at gives the object at an index of a shared region (@see shared_region_index)
+ * @param region is a pointer to the region
+ * @param index is the index of the object
+ * @return a pointer to the object, NULL for an invalid index
+ */
+void *shared_region_at(shared_region_t *region, uint64_t index) {
+    if (!region || !region->base || index < sizeof(shared_region_header_t) || index >= region->size) {
+        return NULL;
+    }
+    return region->base + index;
+}
+
+/*!
+ * @brief clear_shared_region unmaps a shared region (the memory is released by the last process)
+ * @param region is a pointer to the region
+ */
+void clear_shared_region(shared_region_t *region) {
+    if (!region) {
+        return;
+    }
+    if (region->base) {
+        munmap(region->base, region->size);
+    }
+    if (region->fd >= 0) {
+        close(region->fd);
+    }
+    region->base = NULL;
+    region->size = 0;
+    region->fd = -1;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHARED_REGION_SIZE (4ULL * 1024 * 1024 * 1024) // address space only: pages are used when touched
+#define SHARED_REGION_MIN_SIZE (64ULL * 1024 * 1024)
+#define SHARED_INDEX_NONE UINT64_MAX
+
+typedef struct {
+    char *base; // same address in the processes forked after init_shared_region
+    size_t size;
+    int fd;
+} shared_region_t;
+
+int init_shared_region(shared_region_t *region, size_t size);
+void *shared_region_alloc(shared_region_t *region, size_t size, size_t alignment);
+uint64_t shared_region_index(shared_region_t *region, void *pointer);
+void *shared_region_at(shared_region_t *region, uint64_t index);
+void clear_shared_region(shared_region_t *region);
@@ -6,8 +6,13 @@
 #include "utility.h"
 #include "messages.h"
 #include "file-properties.h"
+#include "walker.h"
+#include "file-compare.h"
+#include "file-copy.h"
+#include "delta.h"
+#include "copy-pool.h"
+#include "commit-batch.h"
 #include <fcntl.h>
-#include <sys/sendfile.h>
 #include <unistd.h>
 #include <sys/msg.h>
 
@@ -16,7 +21,6 @@
 #include <stdlib.h>
 
 
-#include <utime.h>
 #include <errno.h>
 
 /*
@@ -37,54 +41,299 @@
  * @param p_context is a pointer to the processes context
  */
 
+static commit_batch_t *destination_commits = NULL; // replacement of the destination files during synchronize
+
 // Cette fonction synchronise les fichiers entre une source et une destination.
 void synchronize(configuration_t *the_config, process_context_t *p_context) {
     // Initialisation des listes de fichiers source et destination
     files_list_t src_list;
-    src_list.head = src_list.tail = NULL;
+    init_files_list(&src_list);
 
     files_list_t dest_list;
-    dest_list.head = dest_list.tail = NULL;
+    init_files_list(&dest_list);
 
     // Construire les listes de fichiers source et destination
-    make_files_list(&src_list, the_config->source);
-    make_files_list(&dest_list, the_config->destination);
+    if (the_config->is_parallel && p_context->uses_threads) {       //analyseurs en threads
+        make_files_lists_threaded(&src_list, &dest_list, the_config, &p_context->analyzers);
+    } else if (the_config->is_parallel) {       //listeurs et analyseurs (@see prepare)
+        make_files_lists_parallel(&src_list, &dest_list, the_config, &p_context->transport);
+    } else {
+        make_files_list(&src_list, the_config->source, the_config);
+        make_files_list(&dest_list, the_config->destination, the_config);
+    }
 
-    // Comparaison et synchronisation des fichiers
-    files_list_entry_t *src_entry = src_list.head;
+    // Comparaison des deux listes en un seul passage (elles sont triées)
+    diff_list_t diff;
+    diff.entries = NULL;
+    diff.count = diff.capacity = 0;
+
+    // Cache persistant des empreintes (dans la destination par défaut)
+    hash_cache_t cache;
+    hash_cache_t *p_cache = NULL;
+    file_compare_t compare;
+    file_compare_t *p_compare = NULL;
+    if (the_config->uses_md5 && the_config->compare_mode != COMPARE_HASH) {       //comparaison directe, sans empreintes
+        if (init_file_compare(&compare, the_config->compare_mode == COMPARE_SAMPLED) == 0) {
+            p_compare = &compare;
+        }
+    }
+    if (the_config->uses_md5 && !p_compare) {
+        set_digest_algorithm(the_config->digest_algorithm);
+        set_tree_hash_threads(the_config->tree_hash_threads);
+        char cache_path[PATH_SIZE];
+        if (the_config->hash_cache[0] != '\0') {
+            strncpy(cache_path, the_config->hash_cache, PATH_SIZE - 1);
+            cache_path[PATH_SIZE - 1] = '\0';
+        } else {
+            concat_path(cache_path, the_config->destination, HASH_CACHE_DEFAULT_NAME);
+        }
+        if (load_hash_cache(&cache, cache_path, the_config->digest_algorithm, the_config->tree_hash_threads ? TREE_HASH_CHUNK_SIZE : 0) == 0) {
+            p_cache = &cache;
+        }
+    }
 
-    while (src_entry != NULL) {
-        // Recherche de l'entrée correspondante dans la liste de destination
-        files_list_entry_t *dest_entry = find_entry_by_name(&dest_list, src_entry->path_and_name, /* start_of_src */ 0, /* start_of_dest */ 0);
+    if (make_diff_list(&diff, &src_list, the_config->source, &dest_list, the_config->destination, the_config->uses_md5, p_cache, p_compare) == 0) {
+        commit_batch_t commits;                     //fichiers temporaires renommés par lots durables
+        if (init_commit_batch(&commits, the_config->durability, the_config->sync_interval, the_config->destination) == 0) {
+            destination_commits = &commits;
+        }
 
+        // Suppression des fichiers temporaires laissés par une exécution interrompue
+        for (size_t i = 0; i < diff.count; ++i) {
+            files_list_entry_t *leftover = diff.entries[i].destination;
+            if (diff.entries[i].type == DIFF_DESTINATION_ONLY && leftover->entry_type == FICHIER && is_commit_tmp(leftover->path_and_name)) {
+                if (unlink(leftover->path_and_name) == 0) {
+                    printf("Fichier temporaire abandonné supprimé : %s\n", leftover->path_and_name);
+                }
+            }
+        }
 
-        // Copier le fichier source s'il n'existe pas dans la destination
-        if (dest_entry == NULL) {
-            copy_entry_to_destination(src_entry, the_config);
+        // Application des différences dans la destination : les dossiers d'abord (dans l'ordre, les parents
+        // avant leur contenu), puis les fichiers, copiés par plusieurs threads si demandé
+        files_list_entry_t **files = malloc((diff.count ? diff.count : 1) * sizeof(files_list_entry_t *));
+        size_t files_count = 0;
+        for (size_t i = 0; i < diff.count; ++i) {
+            if (diff.entries[i].type == DIFF_NEW || diff.entries[i].type == DIFF_MODIFIED) {
+                if (files && diff.entries[i].source->entry_type == FICHIER) {
+                    files[files_count++] = diff.entries[i].source;
+                } else {
+                    copy_entry_to_destination(diff.entries[i].source, the_config);
+                }
+            }
+        }
+        if (files && the_config->copy_threads > 1) {
+            copy_files_parallel(files, files_count, the_config, the_config->copy_threads);
         } else {
-            // Vérifier les différences et mettre à jour si nécessaire
-            if (mismatch(src_entry, dest_entry, the_config->uses_md5)) {
-                copy_entry_to_destination(src_entry, the_config);
+            for (size_t i = 0; i < files_count; ++i) {
+                copy_entry_to_destination(files[i], the_config);
+            }
+        }
+        free(files);
+
+        if (destination_commits) {
+            if (flush_commit_batch(destination_commits) == -1) {
+                printf("Erreur lors de l'écriture durable de la destination\n");
             }
+            clear_commit_batch(destination_commits);
+            destination_commits = NULL;
+        }
+    }
+
+    clear_diff_list(&diff);
+
+    if (p_compare) {
+        if (the_config->verbose) {
+            printf("Compared contents: %lu bytes read\n", (unsigned long)p_compare->bytes_read);
+        }
+        clear_file_compare(p_compare);
+    }
+    if (p_cache) {
+        if (the_config->verbose) {
+            printf("Hash cache: %zu hits, %zu misses\n", p_cache->hits, p_cache->misses);
         }
+        save_hash_cache(p_cache);
+        clear_hash_cache(p_cache);
+    }
 
-        src_entry = src_entry->next;
+    if (the_config->verbose) {          //mémoire utilisée par chaque liste
+        printf("Source list: ");
+        display_files_list_memory(&src_list);
+        printf("Destination list: ");
+        display_files_list_memory(&dest_list);
     }
 
     // Nettoyage - Libérer la mémoire utilisée pour les listes de fichiers
-    files_list_entry_t *src_temp = src_list.head;
-    while (src_temp != NULL) {
-        files_list_entry_t *next = src_temp->next;
-        free(src_temp);
-        src_temp = next;
+    clear_files_list(&src_list);
+    clear_files_list(&dest_list);
+}
+
+/*!
+ * @brief add_diff_entry appends a change to a diff list, growing it when needed
+ * @param diff is a pointer to the diff list
+ * @param type is the type of the change
+ * @param source is the source entry (NULL if the file only exists in the destination)
+ * @param destination is the destination entry (NULL if the file only exists in the source)
+ * @return 0 in case of success, -1 else (out of memory)
+ */
+static int add_diff_entry(diff_list_t *diff, diff_type_t type, files_list_entry_t *source, files_list_entry_t *destination) {
+    if (diff->count == diff->capacity) {            //plus de place : on double la capacité
+        size_t new_capacity = diff->capacity ? diff->capacity * 2 : 256;
+        diff_entry_t *new_entries = realloc(diff->entries, new_capacity * sizeof(diff_entry_t));
+        if (!new_entries) {
+            printf("out of memory\n");
+            return -1;
+        }
+        diff->entries = new_entries;
+        diff->capacity = new_capacity;
     }
 
-    files_list_entry_t *dest_temp = dest_list.head;
-    while (dest_temp != NULL) {
-        files_list_entry_t *next = dest_temp->next;
-        free(dest_temp);
-        dest_temp = next;
+    diff->entries[diff->count].type = type;
+    diff->entries[diff->count].source = source;
+    diff->entries[diff->count].destination = destination;
+    diff->count++;
+
+    return 0;
+}
+
+/*!
+ * @brief needs_md5 tells if MD5 sums are needed to compare two entries (same type, size and mtime)
+ */
+static bool needs_md5(files_list_entry_t *lhd, files_list_entry_t *rhd) {
+    return lhd->entry_type == FICHIER && rhd->entry_type == FICHIER && lhd->size == rhd->size
+           && lhd->mtime.tv_sec == rhd->mtime.tv_sec && lhd->mtime.tv_nsec == rhd->mtime.tv_nsec;
+}
+
+/*!
+ * @brief is_hash_cache_file tells if a path relative to a root names the default hash cache or its temporary file
+ * They belong to the program, not to the synchronized data, whichever tree they are found in.
+ */
+static bool is_hash_cache_file(const char *relative_path) {
+    return strcmp(relative_path, HASH_CACHE_DEFAULT_NAME) == 0 || strcmp(relative_path, HASH_CACHE_DEFAULT_NAME HASH_CACHE_TMP_SUFFIX) == 0;
+}
+
+/*!
+ * @brief make_diff_list compares the source and destination lists in a single pass
+ * Both lists are sorted (strcmp) and share their root prefix, so they can be walked in lockstep
+ * on the path relative to each root (merge-join). Each entry is reported once, in order.
+ * The cost is linear in the number of entries, where a lookup of each source entry in the destination list was quadratic.
+ * Files needing MD5 sums are queued during the merge and hashed together afterwards (@see ensure_files_md5),
+ * then their entries are classified. With a comparison context, their contents are compared directly instead.
+ * The hash cache files at the roots of both trees are left out (@see is_hash_cache_file).
+ * @param diff is a pointer to the diff list to fill (must be empty)
+ * @param src_list is a pointer to the source files list
+ * @param src_root is the source directory the source list was built from
+ * @param dst_list is a pointer to the destination files list
+ * @param dst_root is the destination directory the destination list was built from
+ * @param has_md5 a value to enable or disable MD5 sum check
+ * @param cache is a pointer to the persistent hash cache used for MD5 sums, NULL if none
+ * @param compare is a pointer to the context comparing the contents directly, NULL to compare MD5 sums
+ * @return 0 in case of success, -1 else
+ */
+int make_diff_list(diff_list_t *diff, files_list_t *src_list, char *src_root, files_list_t *dst_list, char *dst_root, bool has_md5, hash_cache_t *cache, file_compare_t *compare) {
+    if (!diff || !src_list || !dst_list) {
+        printf("Invalid parameters\n");
+        return -1;
     }
+
+    size_t start_of_src = get_prefix_length(src_root);          //début du chemin relatif dans chaque liste
+    size_t start_of_dest = get_prefix_length(dst_root);
+
+    files_list_entry_t *src_entry = src_list->head;
+    files_list_entry_t *dest_entry = dst_list->head;
+
+    files_list_entry_t **to_hash = NULL;            //fichiers dont il faut l'empreinte
+    size_t to_hash_count = 0;
+    size_t to_hash_capacity = 0;
+    int result = 0;
+
+    while (src_entry != NULL || dest_entry != NULL) {
+        if (src_entry != NULL && is_hash_cache_file(src_entry->path_and_name + start_of_src)) {        //cache d'empreintes : ni copié ni supprimé
+            src_entry = src_entry->next;
+            continue;
+        }
+        if (dest_entry != NULL && is_hash_cache_file(dest_entry->path_and_name + start_of_dest)) {
+            dest_entry = dest_entry->next;
+            continue;
+        }
+
+        int order;
+        if (src_entry == NULL) {                    //il ne reste que la destination
+            order = 1;
+        } else if (dest_entry == NULL) {            //il ne reste que la source
+            order = -1;
+        } else {
+            order = strcmp(src_entry->path_and_name + start_of_src, dest_entry->path_and_name + start_of_dest);
+        }
+
+        if (order < 0 && is_commit_tmp(src_entry->path_and_name)) {     //fichier temporaire abandonné : jamais copié
+            src_entry = src_entry->next;
+            continue;
+        }
+        if (order < 0) {                            //absent de la destination
+            result = add_diff_entry(diff, DIFF_NEW, src_entry, NULL);
+            src_entry = src_entry->next;
+        } else if (order > 0) {                     //absent de la source
+            result = add_diff_entry(diff, DIFF_DESTINATION_ONLY, NULL, dest_entry);
+            dest_entry = dest_entry->next;
+        } else {                                    //présent des deux côtés
+            diff_type_t type = DIFF_UNCHANGED;
+            if (has_md5 && compare && needs_md5(src_entry, dest_entry)) {      //lecture des deux fichiers
+                if (compare_files_content(compare, src_entry->path_and_name, dest_entry->path_and_name, src_entry->size) != 0) {
+                    type = DIFF_MODIFIED;
+                }
+            } else if (has_md5 && needs_md5(src_entry, dest_entry)) {     //classé une fois les empreintes calculées
+                if (to_hash_count + 2 > to_hash_capacity) {
+                    size_t new_capacity = to_hash_capacity ? to_hash_capacity * 2 : 256;
+                    files_list_entry_t **new_to_hash = realloc(to_hash, new_capacity * sizeof(files_list_entry_t *));
+                    if (!new_to_hash) {
+                        printf("out of memory\n");
+                        free(to_hash);
+                        return -1;
+                    }
+                    to_hash = new_to_hash;
+                    to_hash_capacity = new_capacity;
+                }
+                to_hash[to_hash_count++] = src_entry;
+                to_hash[to_hash_count++] = dest_entry;
+            } else if (mismatch(src_entry, dest_entry, has_md5)) {
+                type = DIFF_MODIFIED;
+            }
+            result = add_diff_entry(diff, type, src_entry, dest_entry);
+            src_entry = src_entry->next;
+            dest_entry = dest_entry->next;
+        }
+
+        if (result == -1) {
+            free(to_hash);
+            return -1;
+        }
+    }
+
+    if (to_hash_count > 0) {                        //empreintes par lots (cache, puis MD5 multi-flux)
+        ensure_files_md5(to_hash, to_hash_count, cache);
+        for (size_t i = 0; i < diff->count; ++i) {
+            diff_entry_t *entry = &diff->entries[i];
+            if (entry->type == DIFF_UNCHANGED && mismatch(entry->source, entry->destination, has_md5)) {
+                entry->type = DIFF_MODIFIED;
+            }
+        }
+    }
+
+    free(to_hash);
+    return 0;
+}
+
+/*!
+ * @brief clear_diff_list frees a diff list (the entries it points to belong to their files lists)
+ * @param diff is a pointer to the diff list to clear
+ */
+void clear_diff_list(diff_list_t *diff) {
+    if (!diff) {
+        return;
+    }
+    free(diff->entries);
+    diff->entries = NULL;
+    diff->count = diff->capacity = 0;
 }
 
 /*!
@@ -93,6 +342,8 @@ void synchronize(configuration_t *the_config, process_context_t *p_context) {
  * @param rhd a files list entry from the destination
  * @has_md5 a value to enable or disable MD5 sum check
  * @return true if both files are not equal, false else
+ * MD5 sums are computed here, only when type, size and mtime are equal (@see ensure_file_md5).
+ * A file that cannot be hashed is reported as different.
  */
 bool mismatch(files_list_entry_t *lhd, files_list_entry_t *rhd, bool has_md5) {
 
@@ -110,12 +361,15 @@ bool mismatch(files_list_entry_t *lhd, files_list_entry_t *rhd, bool has_md5) {
     }
 
    
-    if (lhd->mtime.tv_nsec != rhd->mtime.tv_nsec) {             //test si la date de modification est la meme
+    if (lhd->mtime.tv_sec != rhd->mtime.tv_sec || lhd->mtime.tv_nsec != rhd->mtime.tv_nsec) {             //test si la date de modification est la meme
         return true;
     }
 
     
-    if (has_md5) {          //si le parm md5 est true
+    if (has_md5 && lhd->entry_type == FICHIER) {          //si le parm md5 est true : seul cas où on lit les fichiers
+        if (ensure_file_md5(lhd, NULL) == -1 || ensure_file_md5(rhd, NULL) == -1) {          //calcul à la demande
+            return true;
+        }
         if (memcmp(lhd->md5sum, rhd->md5sum, sizeof(lhd->md5sum)) != 0) {                   //compare les md5
             return true;
         }
@@ -128,8 +382,9 @@ bool mismatch(files_list_entry_t *lhd, files_list_entry_t *rhd, bool has_md5) {
  * @brief make_files_list buils a files list in no parallel mode
  * @param list is a pointer to the list that will be built
  * @param target_path is the path whose files to list
+ * @param the_config is a pointer to the program configuration
  */
-void make_files_list(files_list_t *list, char *target_path) {
+void make_files_list(files_list_t *list, char *target_path, configuration_t *the_config) {
 
      if (!list || !target_path) {
         printf("Invalid parameters\n");
@@ -137,14 +392,10 @@ void make_files_list(files_list_t *list, char *target_path) {
     }
 
 
-    make_list(list, target_path);          //construie la liste
+    make_list(list, target_path, the_config->walker_threads);          //construie la liste
 
-    files_list_entry_t *current = list->head;
-    while (current != NULL) {
-        if (get_file_stats(current) == -1) {                //ajout des stats
-            printf("erreur dans l'obtention des stats");
-        }
-        current = current->next;
+    if (get_files_list_stats(list) != 0) {                //ajout des stats (par lots)
+        printf("erreur dans l'obtention des stats\n");
     }
 }
 
@@ -153,25 +404,85 @@ void make_files_list(files_list_t *list, char *target_path) {
  * @param src_list is a pointer to the source list to build
  * @param dst_list is a pointer to the destination list to build
  * @param the_config is a pointer to the program configuration
- * @param msg_queue is the id of the MQ used for communication
+ * @param transport is a pointer to the transport of the messages
  */
-void make_files_lists_parallel(files_list_t *src_list, files_list_t *dst_list, configuration_t *the_config, int msg_queue) {
+void make_files_lists_parallel(files_list_t *src_list, files_list_t *dst_list, configuration_t *the_config, transport_t *transport) {
+
+    if (!src_list || !dst_list || !the_config) {
+        printf("Invalid parameters\n");
+        return;
+    }
+
+    send_analyze_dir_command(transport, MSG_TYPE_TO_SOURCE_LISTER, the_config->source);            //les deux listes en même temps
+    send_analyze_dir_command(transport, MSG_TYPE_TO_DESTINATION_LISTER, the_config->destination);
+
+    any_message_t msg;
+    int completed = 0;
+    bool src_listed = false;
+    bool dst_listed = false;
+    while (completed < 2) {
+        if (receive_message(transport, -MSG_TYPE_TO_MAIN_DESTINATION, &msg) == -1) {     //topics de la source et de la destination
+            break;
+        }
+        if (msg.list_entry.op_code != COMMAND_CODE_LIST_COMPLETE && msg.list_entry.op_code != COMMAND_CODE_LIST_FAILED) {
+            continue;
+        }
+        completed++;
+
+        files_list_t *list = get_message_list(&msg.list_entry);       //construite par le listeur dans la mémoire partagée
+        if (list && msg.list_entry.op_code == COMMAND_CODE_LIST_COMPLETE) {
+            bool is_source = msg.list_entry.mtype == MSG_TYPE_TO_MAIN;
+            *(is_source ? src_list : dst_list) = *list;     //aucune copie des entrées
+            *(is_source ? &src_listed : &dst_listed) = true;
+        }
+    }
 
+    if ((src_listed && sort_files_list(src_list) == -1) || (dst_listed && sort_files_list(dst_list) == -1)) {      //walk_tree ne trie pas les listes
+        printf("erreur dans le tri de la liste\n");
+    }
+
+    //liste incomplète (parcours en échec, mémoire partagée épuisée) : elle est refaite dans ce processus
+    if (!src_listed) {
+        printf("Liste de %s incomplète, elle est refaite sans les listeurs\n", the_config->source);
+        make_files_list(src_list, the_config->source, the_config);
+    }
+    if (!dst_listed) {
+        printf("Liste de %s incomplète, elle est refaite sans les listeurs\n", the_config->destination);
+        make_files_list(dst_list, the_config->destination, the_config);
+    }
 }
 /*!
- * @brief copy_entry_to_destination copies a file from the source to the destination
- * It keeps access modes and mtime (@see utimensat)
- * Pay attention to the path so that the prefixes are not repeated from the source to the destination
- * Use sendfile to copy the file, mkdir to create the directory
+ * @brief make_files_lists_threaded makes both (src and dest) files list with the analyzer threads
+ * The lists are walked in the main process, then their entries are analyzed in place by the threads.
+ * @param src_list is a pointer to the source list to build
+ * @param dst_list is a pointer to the destination list to build
+ * @param the_config is a pointer to the program configuration
+ * @param analyzers is a pointer to the pool of analyzer threads
  */
-void copy_entry_to_destination(files_list_entry_t *source_entry, configuration_t *the_config) {
-    // Création du chemin de destination en utilisant le répertoire source et destination
-    char destination_path[PATH_SIZE];
-    strncpy(destination_path, source_entry->path_and_name, sizeof(destination_path));
-    strncpy(destination_path, the_config->destination, PATH_SIZE- 1);
-    destination_path[PATH_SIZE- 1] = '\0';
-    strncpy(destination_path + strlen(the_config->destination), source_entry->path_and_name + strlen(the_config->source), sizeof(destination_path) - strlen(the_config->destination));
+void make_files_lists_threaded(files_list_t *src_list, files_list_t *dst_list, configuration_t *the_config, analyzer_pool_t *analyzers) {
+
+    if (!src_list || !dst_list || !the_config || !analyzers) {
+        printf("Invalid parameters\n");
+        return;
+    }
 
+    make_list(src_list, the_config->source, the_config->walker_threads);
+    submit_files_list(analyzers, src_list);                 //analyse de la source pendant le parcours de la destination
+    make_list(dst_list, the_config->destination, the_config->walker_threads);
+    submit_files_list(analyzers, dst_list);
+
+    if (wait_analyzer_pool(analyzers) != 0) {
+        printf("erreur dans l'obtention des stats\n");
+    }
+}
+
+/*!
+ * @brief copy_entry_to_path copies a file or directory from the source to its destination path
+ * @param source_entry is a pointer to the source entry
+ * @param destination_path is the path of the entry in the destination
+ * @param the_config is a pointer to the program configuration
+ */
+static void copy_entry_to_path(files_list_entry_t *source_entry, char *destination_path, configuration_t *the_config) {
     // Vérification s'il s'agit d'un dossier, création dans la destination si nécessaire
     if (source_entry->entry_type == DOSSIER) {
         if (mkdir(destination_path, source_entry->mode) == -1 ) {
@@ -179,6 +490,46 @@ void copy_entry_to_destination(files_list_entry_t *source_entry, configuration_t
             return;
         }
     } else { // Si c'est un fichier
+        bool copied = false;
+        char *delta_tmp_path = NULL;            //fichier reconstruit, à renommer avec les autres fichiers du lot
+        if (the_config->delta && source_entry->size >= DELTA_MIN_SIZE) {    //gros fichier modifié : blocs changés seulement
+            delta_stats_t stats;
+            bool durable = destination_commits && destination_commits->mode != DURABILITY_NONE;
+            int result = delta_copy_file(source_entry->path_and_name, destination_path, &stats, durable ? &delta_tmp_path : NULL);
+            if (result == 0) {
+                copied = true;
+                if (the_config->verbose) {
+                    printf("%s: delta %s, %lu bytes read, %lu bytes written, %lu bytes reused\n", destination_path,
+                           stats.in_place ? "in place" : "by temporary file", (unsigned long)stats.bytes_read,
+                           (unsigned long)stats.bytes_written, (unsigned long)stats.matched_bytes);
+                }
+            } else if (result == -1) {
+                printf("Erreur lors de la copie différentielle de %s, copie complète\n", source_entry->path_and_name);
+            }
+        }
+
+        if (copied) {
+            //modification de la date de modification (du fichier temporaire s'il n'est pas encore renommé)
+            char *written_path = delta_tmp_path ? delta_tmp_path : destination_path;
+            struct stat source_stat;
+            if (stat(source_entry->path_and_name, &source_stat) == -1) {
+                printf("Erreur lors de la récupération des informations sur le fichier source");
+            } else {
+                struct timespec times[2];           //à la nanoseconde près, comme dans la liste
+                times[0] = source_stat.st_atim;
+                times[1] = source_stat.st_mtim;
+
+                if (utimensat(AT_FDCWD, written_path, times, 0) == -1) {
+                    printf("Erreur lors de la modification du temps de modification du fichier destination");
+                }
+            }
+            if (delta_tmp_path) {
+                commit_file(destination_commits, delta_tmp_path, destination_path);
+                free(delta_tmp_path);
+            }
+            return;
+        }
+
         // Ouverture du fichier source en lecture
         int source_fd = open(source_entry->path_and_name, O_RDONLY);
         if (source_fd == -1) {
@@ -186,90 +537,111 @@ void copy_entry_to_destination(files_list_entry_t *source_entry, configuration_t
             return;
         }
 
-        // Ouverture ou création du fichier destination en écriture
-        int destination_fd = open(destination_path, O_WRONLY | O_CREAT | O_TRUNC, source_entry->mode);
+        // Écriture dans un fichier temporaire du même dossier, renommé une fois complet
+        size_t tmp_size = strlen(destination_path) + sizeof(COMMIT_TMP_SUFFIX) + 6;
+        char *tmp_path = malloc(tmp_size);
+        int destination_fd = tmp_path ? create_commit_tmp(destination_path, source_entry->mode, tmp_path, tmp_size) : -1;
         if (destination_fd == -1) {
             printf("Erreur lors de l'ouverture du fichier destination");
             close(source_fd);
+            free(tmp_path);
             return;
         }
 
-        // Copie du contenu du fichier source vers le fichier destination
-        off_t offset = 0;
-        ssize_t bytes_copied = sendfile(destination_fd, source_fd, &offset, source_entry->size);
-        if (bytes_copied == -1) {
-            printf("Erreur lors de la copie du fichier");
+        // Copie du contenu du fichier source vers le fichier destination (clonage si possible)
+        copy_report_t report;
+        int result = copy_file_content(source_fd, destination_fd, source_entry->size, &report);
+        if (result == -1) {
+            printf("Erreur lors de la copie du fichier %s\n", source_entry->path_and_name);
+        } else if (the_config->verbose && report.sparse) {
+            printf("%s: %s, sparse (%lu data bytes)\n", destination_path, copy_strategy_name(report.strategy), (unsigned long)report.data_bytes);
+        } else if (the_config->verbose) {
+            printf("%s: %s\n", destination_path, copy_strategy_name(report.strategy));
         }
 
-        // Fermeture des descripteurs de fichiers
-        close(source_fd);
-        close(destination_fd);
-
-
-        //modification de la date de modification 
+        //modification de la date de modification, avant que le fichier ne prenne sa place
         struct stat source_stat;
-        if (stat(source_entry->path_and_name, &source_stat) == -1) {
-            printf("Erreur lors de la récupération des informations sur le fichier source");
-            return;
+        if (result == 0 && fstat(source_fd, &source_stat) == 0) {
+            struct timespec times[2];               //à la nanoseconde près, comme dans la liste
+            times[0] = source_stat.st_atim;
+            times[1] = source_stat.st_mtim;
+            if (futimens(destination_fd, times) == -1) {
+                printf("Erreur lors de la modification du temps de modification du fichier destination");
+            }
         }
 
-        struct utimbuf times;
-        times.actime = source_stat.st_atime;
-        times.modtime = source_stat.st_mtime;
+        // Fermeture des descripteurs de fichiers
+        close(source_fd);
+        if (close(destination_fd) == -1) {
+            result = -1;
+        }
 
-        if (utime(destination_path, &times) == -1) {
-            printf("Erreur lors de la modification du temps de modification du fichier destination");
+        if (result == -1) {                     //la destination reste intacte
+            unlink(tmp_path);
+        } else if (destination_commits) {
+            commit_file(destination_commits, tmp_path, destination_path);
+        } else if (rename(tmp_path, destination_path) == -1) {
+            printf("Erreur lors du renommage de %s\n", tmp_path);
+            unlink(tmp_path);
         }
+        free(tmp_path);
     }
 }
 
+/*!
+ * @brief copy_entry_to_destination copies a file from the source to the destination
+ * It keeps access modes and mtime (@see utimensat)
+ * Pay attention to the path so that the prefixes are not repeated from the source to the destination
+ * The content of files is copied by copy_file_content (clone, copy_file_range, sendfile or read/write), mkdir creates the directory
+ */
+void copy_entry_to_destination(files_list_entry_t *source_entry, configuration_t *the_config) {
+    // Création du chemin de destination en utilisant le répertoire source et destination (sans limite de longueur,
+    // comme les chemins produits par le parcours)
+    size_t destination_length = strlen(the_config->destination);
+    char *relative_path = source_entry->path_and_name + get_prefix_length(the_config->source);
+    bool needs_separator = destination_length > 0 && the_config->destination[destination_length - 1] != '/';   //comme concat_path
+    char *destination_path = malloc(destination_length + needs_separator + strlen(relative_path) + 1);
+    if (!destination_path) {
+        printf("out of memory\n");
+        return;
+    }
+    memcpy(destination_path, the_config->destination, destination_length);
+    if (needs_separator) {
+        destination_path[destination_length++] = '/';
+    }
+    strcpy(destination_path + destination_length, relative_path);
+
+    copy_entry_to_path(source_entry, destination_path, the_config);
+    free(destination_path);
+}
+
 
 
 
 /*!
  * @brief make_list lists files in a location (it recurses in directories)
  * It doesn't get files properties, only a list of paths
+ * Paths are collected without ordering by the fd-relative walker (@see walk_tree), then the list
+ * is sorted once (strcmp order)
  * This function is used by make_files_list and make_files_list_parallel
  * @param list is a pointer to the list that will be built
  * @param target is the target dir whose content must be listed
+ * @param walker_threads is the number of threads walking the tree
  */
-void make_list(files_list_t *list, char *target) {
+void make_list(files_list_t *list, char *target, int walker_threads) {
 
     if (!list || !target) {
         printf("Invalid parameters\n");
         return;
     }
-    // Ouvrir le répertoire spécifié
-    DIR *dir = open_dir(target);
 
-    // Vérifier si l'ouverture du répertoire a échoué
-    if (dir == NULL) {
-        printf("erreur");
-        return;
+    if (walk_tree(list, target, walker_threads) == -1) {    //collecte des chemins
+        printf("erreur dans le parcours de %s\n", target);
     }
 
-    struct dirent *entry;
-
-    // Parcourir les entrées du répertoire
-    while ((entry = get_next_entry(dir)) != NULL) {
-        char full_path[PATH_SIZE];
-
-        // Construire le chemin complet de l'entrée (fichier ou dossier)
-        concat_path(full_path, target, entry->d_name);
-
-        // Si l'entrée est un dossier
-       if (directory_exists(full_path)) {
-            // Ajouter le dossier à la liste et appeler récursivement make_list pour explorer le dossier
-            add_file_entry(list, full_path);
-            make_list(list, full_path);
-        } else { // Si l'entrée est un fichier
-            // Ajouter le fichier à la liste
-            add_file_entry(list, full_path);
-        }
+    if (sort_files_list(list) == -1) {     //un seul tri à la fin
+        printf("erreur dans le tri de la liste\n");
     }
-
-    // Fermer le répertoire
-    closedir(dir);
 }
 
 
@@ -299,6 +671,8 @@ DIR *open_dir(char *path) {
  * @param dir is a pointer to the dir (as a result of opendir, @see open_dir)
  * @return a struct dirent pointer to the next relevant entry, NULL if none found (use it to stop iterating)
  * Relevant entries are all regular files and dir, except . and ..
+ * The type is taken from d_type; only when the filesystem doesn't provide it (DT_UNKNOWN) is the entry
+ * stat'ed, with fstatat relative to the dir, and d_type is then set to DT_DIR or DT_REG.
  */
 struct dirent *get_next_entry(DIR *dir) {
     
@@ -310,6 +684,21 @@ struct dirent *get_next_entry(DIR *dir) {
             continue;
         }
 
+        if (entry->d_type == DT_UNKNOWN) {          //type non fourni par le systeme de fichiers
+            struct stat stats;
+            if (fstatat(dirfd(dir), entry->d_name, &stats, AT_SYMLINK_NOFOLLOW) == -1) {
+                continue;
+            }
+            if (S_ISDIR(stats.st_mode)) {
+                entry->d_type = DT_DIR;
+            } else if (S_ISREG(stats.st_mode)) {
+                entry->d_type = DT_REG;
+            }
+        }
+
+        if (entry->d_type != DT_DIR && entry->d_type != DT_REG) {   //fichiers speciaux (liens, sockets, ...) ignorés
+            continue;
+        }
 
         return entry;
     }
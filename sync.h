@@ -4,13 +4,33 @@
 #include "files-list.h"
 #include "configuration.h"
 #include "processes.h"
+#include "hash-cache.h"
+#include "file-compare.h"
 #include <dirent.h>
+#include <stddef.h>
+
+typedef enum { DIFF_NEW, DIFF_MODIFIED, DIFF_UNCHANGED, DIFF_DESTINATION_ONLY } diff_type_t;
+
+typedef struct {
+    diff_type_t type;
+    files_list_entry_t *source; // NULL for DIFF_DESTINATION_ONLY
+    files_list_entry_t *destination; // NULL for DIFF_NEW
+} diff_entry_t;
+
+typedef struct {
+    diff_entry_t *entries;
+    size_t count;
+    size_t capacity;
+} diff_list_t;
 
 void synchronize(configuration_t *the_config, process_context_t *p_context);
-void make_files_list(files_list_t *list, char *target_path);
+void make_files_list(files_list_t *list, char *target_path, configuration_t *the_config);
+int make_diff_list(diff_list_t *diff, files_list_t *src_list, char *src_root, files_list_t *dst_list, char *dst_root, bool has_md5, hash_cache_t *cache, file_compare_t *compare);
+void clear_diff_list(diff_list_t *diff);
 bool mismatch(files_list_entry_t *lhd, files_list_entry_t *rhd, bool has_md5);
-void make_files_lists_parallel(files_list_t *src_list, files_list_t *dst_list, configuration_t *the_config, int msg_queue);
+void make_files_lists_threaded(files_list_t *src_list, files_list_t *dst_list, configuration_t *the_config, analyzer_pool_t *analyzers);
+void make_files_lists_parallel(files_list_t *src_list, files_list_t *dst_list, configuration_t *the_config, transport_t *transport);
 void copy_entry_to_destination(files_list_entry_t *source_entry, configuration_t *the_config);
-void make_list(files_list_t *list, char *target);
+void make_list(files_list_t *list, char *target, int walker_threads);
 DIR *open_dir(char *path);
 struct dirent *get_next_entry(DIR *dir);
\ No newline at end of file
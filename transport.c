@@ -0,0 +1,304 @@
+#include "transport.h"
+#include <sys/msg.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+
+// Transport des messages entre les processus, au choix :
+// - la file de messages System V (un appel système par message, clé privée à chaque exécution)
+// - des anneaux MPMC sans verrou dans la mémoire partagée (un par destinataire) : les processus ne
+//   passent par le noyau que pour dormir quand l'anneau est vide (ou plein), avec un futex
+
+typedef struct {
+    atomic_uint_least64_t sequence; // position + 1 when filled, position + capacity when free again
+    size_t length; // bytes of the message, mtype included
+    long data[TRANSPORT_MESSAGE_SIZE / sizeof(long)];
+} ring_slot_t;
+
+struct _transport_ring {
+    _Alignas(64) atomic_uint_least64_t head; // next position to receive
+    _Alignas(64) atomic_uint_least64_t tail; // next position to send
+    _Alignas(64) atomic_uint items; // futex: incremented after each send
+    atomic_uint receive_waiters;
+    _Alignas(64) atomic_uint spaces; // futex: incremented after each receive
+    atomic_uint send_waiters;
+    _Alignas(64) ring_slot_t slots[TRANSPORT_RING_CAPACITY];
+};
+
+/*!
+ * @brief parse_transport_kind gets a transport from its name
+ * @param name is the name (mq or ring)
+ * @param kind is a pointer to the transport to set
+ * @return 0 if the name is known, -1 else
+ */
+int parse_transport_kind(const char *name, transport_kind_t *kind) {
+    if (strcmp(name, "mq") == 0) {
+        *kind = TRANSPORT_MQ;
+    } else if (strcmp(name, "ring") == 0) {
+        *kind = TRANSPORT_RING;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/*!
+ * @brief transport_kind_name gives the name of a transport
+ * @param kind is the transport
+ * @return its name
+ */
+const char *transport_kind_name(transport_kind_t kind) {
+    return (kind == TRANSPORT_RING) ? "ring" : "mq";
+}
+
+static void futex_wait(atomic_uint *word, unsigned value) {
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAIT, value, NULL, NULL, 0);      //pas FUTEX_PRIVATE : partagé entre processus
+}
+
+static void futex_wake(atomic_uint *word) {
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/*!
+ * @brief ring_of gives the ring of a recipient (mtype, or -mtype to get the main topics together)
+ */
+static transport_ring_t *ring_of(transport_t *transport, long recipient) {
+    if (recipient < 0) {
+        recipient = -recipient;
+    }
+    if (recipient < 1 || recipient > TRANSPORT_TOPICS) {
+        return NULL;
+    }
+    return transport->rings[(recipient <= TRANSPORT_MAIN_TOPICS) ? 0 : recipient - TRANSPORT_MAIN_TOPICS];
+}
+
+/*!
+ * @brief ring_send copies a message into a ring, waiting while the ring is full
+ * @param ring is the ring
+ * @param msg is the message, mtype included
+ * @param length is the size of the message, mtype included
+ */
+static void ring_send(transport_ring_t *ring, const void *msg, size_t length) {
+    uint64_t position = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    ring_slot_t *slot;
+    int spins = 0;
+
+    while (true) {
+        slot = &ring->slots[position & (TRANSPORT_RING_CAPACITY - 1)];
+        int64_t difference = (int64_t)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - position);
+        if (difference == 0) {              //place libre : on la réserve
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {        //anneau plein
+            if (++spins < TRANSPORT_SPIN_COUNT) {
+                cpu_relax();
+            } else {
+                atomic_fetch_add(&ring->send_waiters, 1);
+                unsigned seen = atomic_load(&ring->spaces);
+                if ((int64_t)(atomic_load(&slot->sequence) - position) < 0) {     //toujours plein après l'inscription
+                    futex_wait(&ring->spaces, seen);
+                }
+                atomic_fetch_sub(&ring->send_waiters, 1);
+                spins = 0;
+            }
+            position = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        } else {                            //un autre processus a pris la place
+            position = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+
+    memcpy(slot->data, msg, length);
+    slot->length = length;
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);       //publication
+
+    atomic_fetch_add(&ring->items, 1);
+    if (atomic_load(&ring->receive_waiters) > 0) {
+        futex_wake(&ring->items);
+    }
+}
+
+/*!
+ * @brief ring_receive copies the next message of a ring, waiting while the ring is empty
+ * @param ring is the ring
+ * @param msg is the buffer of the message, mtype included
+ * @param max_length is the size of the buffer
+ * @return the size of the message, mtype included
+ */
+static size_t ring_receive(transport_ring_t *ring, void *msg, size_t max_length) {
+    uint64_t position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ring_slot_t *slot;
+    int spins = 0;
+
+    while (true) {
+        slot = &ring->slots[position & (TRANSPORT_RING_CAPACITY - 1)];
+        int64_t difference = (int64_t)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - (position + 1));
+        if (difference == 0) {              //message publié : on le réserve
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {        //anneau vide
+            if (++spins < TRANSPORT_SPIN_COUNT) {
+                cpu_relax();
+            } else {
+                atomic_fetch_add(&ring->receive_waiters, 1);
+                unsigned seen = atomic_load(&ring->items);
+                if ((int64_t)(atomic_load(&slot->sequence) - (position + 1)) < 0) {       //toujours vide après l'inscription
+                    futex_wait(&ring->items, seen);
+                }
+                atomic_fetch_sub(&ring->receive_waiters, 1);
+                spins = 0;
+            }
+            position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        } else {                            //un autre processus a pris le message
+            position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+
+    size_t length = slot->length;
+    memcpy(msg, slot->data, (length < max_length) ? length : max_length);
+    atomic_store_explicit(&slot->sequence, position + TRANSPORT_RING_CAPACITY, memory_order_release);     //place libérée pour le tour suivant
+
+    atomic_fetch_add(&ring->spaces, 1);
+    if (atomic_load(&ring->send_waiters) > 0) {
+        futex_wake(&ring->spaces);
+    }
+    return length;
+}
+
+/*!
+ * @brief init_transport creates the transport of the messages, to be done before forking
+ * @param transport is a pointer to the transport to initialize
+ * @param kind is the transport to use
+ * @param region is the shared region where the rings are allocated (TRANSPORT_RING)
+ * @return 0 if all went good, -1 else
+ */
+int init_transport(transport_t *transport, transport_kind_t kind, shared_region_t *region) {
+    memset(transport, 0, sizeof(transport_t));
+    transport->kind = kind;
+    transport->msg_queue = -1;
+
+    if (kind == TRANSPORT_MQ) {
+        transport->msg_queue = msgget(IPC_PRIVATE, IPC_CREAT | 0600);       //clé privée : pas de collision entre deux exécutions
+        if (transport->msg_queue == -1) {
+            printf("Erreur lors de la création de la file de messages\n");
+            return -1;
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < TRANSPORT_RINGS; ++i) {
+        transport_ring_t *ring = shared_region_alloc(region, sizeof(transport_ring_t), _Alignof(transport_ring_t));
+        if (!ring) {
+            return -1;
+        }
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->tail, 0);
+        atomic_init(&ring->items, 0);
+        atomic_init(&ring->receive_waiters, 0);
+        atomic_init(&ring->spaces, 0);
+        atomic_init(&ring->send_waiters, 0);
+        for (uint64_t position = 0; position < TRANSPORT_RING_CAPACITY; ++position) {
+            atomic_init(&ring->slots[position].sequence, position);
+        }
+        transport->rings[i] = ring;
+    }
+    return 0;
+}
+
+/*!
+ * @brief transport_send sends a message to the recipient given by its mtype (first field of the message)
+ * @param transport is a pointer to the transport
+ * @param msg is the message
+ * @param length is the size of the message after the mtype (as msgsnd)
+ * @return 0 if all went good, -1 else
+ */
+int transport_send(transport_t *transport, const void *msg, size_t length) {
+    if (transport->kind == TRANSPORT_MQ) {
+        int result;
+        do {
+            result = msgsnd(transport->msg_queue, msg, length, 0);
+        } while (result == -1 && errno == EINTR);      //interrompu par un signal : on recommence
+        return result;
+    }
+
+    transport_ring_t *ring = ring_of(transport, *(const long *)msg);
+    if (!ring || length + sizeof(long) > TRANSPORT_MESSAGE_SIZE) {
+        printf("Invalid parameters\n");
+        return -1;
+    }
+    ring_send(ring, msg, length + sizeof(long));
+    return 0;
+}
+
+/*!
+ * @brief transport_receive waits for the next message of a recipient
+ * @param transport is a pointer to the transport
+ * @param recipient is the mtype to receive (-n: any mtype up to n, only for the main topics with the rings)
+ * @param msg is the buffer of the message
+ * @param max_length is the size of the buffer after the mtype (as msgrcv)
+ * @return the size of the message after the mtype, -1 in case of error
+ */
+ssize_t transport_receive(transport_t *transport, long recipient, void *msg, size_t max_length) {
+    if (transport->kind == TRANSPORT_MQ) {
+        ssize_t result;
+        do {
+            result = msgrcv(transport->msg_queue, msg, max_length, recipient, 0);
+        } while (result == -1 && errno == EINTR);
+        return result;
+    }
+
+    transport_ring_t *ring = ring_of(transport, recipient);
+    if (!ring) {
+        printf("Invalid parameters\n");
+        return -1;
+    }
+    return ring_receive(ring, msg, max_length + sizeof(long)) - sizeof(long);
+}
+
+/*!
+ * @brief transport_depth gives the number of messages waiting to be received
+ * @param transport is a pointer to the transport
+ * @param recipient is the mtype of the messages (exact with the rings, the whole queue with the MQ)
+ * @return the number of messages, -1 in case of error
+ */
+ssize_t transport_depth(transport_t *transport, long recipient) {
+    if (transport->kind == TRANSPORT_MQ) {
+        struct msqid_ds stats;
+        if (msgctl(transport->msg_queue, IPC_STAT, &stats) == -1) {
+            return -1;
+        }
+        return stats.msg_qnum;              //tous destinataires confondus
+    }
+
+    transport_ring_t *ring = ring_of(transport, recipient);
+    if (!ring) {
+        return -1;
+    }
+    uint64_t head = atomic_load(&ring->head);
+    uint64_t tail = atomic_load(&ring->tail);
+    return (tail > head) ? (ssize_t)(tail - head) : 0;
+}
+
+/*!
+ * @brief clear_transport releases the transport (the rings are released with their shared region)
+ * @param transport is a pointer to the transport
+ */
+void clear_transport(transport_t *transport) {
+    if (transport->kind == TRANSPORT_MQ && transport->msg_queue != -1) {
+        msgctl(transport->msg_queue, IPC_RMID, NULL);
+    }
+    transport->msg_queue = -1;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "shared-region.h"
+
+#define TRANSPORT_TOPICS 6 // mtypes of the messages, from 1
+#define TRANSPORT_MAIN_TOPICS 2 // mtypes 1 and 2 share the first ring, so that they can be received together (-2)
+#define TRANSPORT_RINGS (TRANSPORT_TOPICS - TRANSPORT_MAIN_TOPICS + 1)
+#define TRANSPORT_RING_CAPACITY 128 // messages per ring (a power of 2)
+#define TRANSPORT_MESSAGE_SIZE 4224 // largest message, mtype included
+#define TRANSPORT_SPIN_COUNT 64 // tries before sleeping on the futex
+
+typedef enum {
+    TRANSPORT_MQ, // System V message queue (IPC_PRIVATE)
+    TRANSPORT_RING, // lock-free rings in shared memory, futex wake-ups
+} transport_kind_t;
+
+typedef struct _transport_ring transport_ring_t;
+
+typedef struct {
+    transport_kind_t kind;
+    int msg_queue; // TRANSPORT_MQ
+    transport_ring_t *rings[TRANSPORT_RINGS]; // TRANSPORT_RING, in a shared region
+} transport_t;
+
+int parse_transport_kind(const char *name, transport_kind_t *kind);
+const char *transport_kind_name(transport_kind_t kind);
+int init_transport(transport_t *transport, transport_kind_t kind, shared_region_t *region);
+int transport_send(transport_t *transport, const void *msg, size_t length);
+ssize_t transport_receive(transport_t *transport, long recipient, void *msg, size_t max_length);
+ssize_t transport_depth(transport_t *transport, long recipient);
+void clear_transport(transport_t *transport);
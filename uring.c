@@ -0,0 +1,158 @@
+#include "uring.h"
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+// Accès minimal à io_uring par les appels système (sans liburing) : une file de soumission,
+// une file de complétion, et les fonctions pour les remplir et les vider
+
+/*!
+ * @brief uring_init creates an io_uring instance and maps its queues
+ * @param ring is a pointer to the ring to initialize
+ * @param entries is the size of the submission queue
+ * @return 0 if all went good, -1 else (io_uring unavailable)
+ */
+int uring_init(uring_t *ring, unsigned entries) {
+    memset(ring, 0, sizeof(uring_t));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->ring_fd < 0) {                //noyau trop ancien ou io_uring interdit
+        ring->ring_fd = -1;
+        return -1;
+    }
+    ring->entries = params.sq_entries;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {        //les deux files partagent la même zone
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        uring_exit(ring);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            uring_exit(ring);
+            return -1;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        uring_exit(ring);
+        return -1;
+    }
+
+    char *sq = ring->sq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+
+    char *cq = ring->cq_ring;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    return 0;
+}
+
+/*!
+ * @brief uring_exit unmaps the queues and closes an io_uring instance
+ * @param ring is a pointer to the ring
+ */
+void uring_exit(uring_t *ring) {
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->ring_fd >= 0) {
+        close(ring->ring_fd);
+    }
+    memset(ring, 0, sizeof(uring_t));
+    ring->ring_fd = -1;
+}
+
+/*!
+ * @brief uring_get_sqe gets a free submission entry, to be filled by the caller
+ * @param ring is a pointer to the ring
+ * @return a pointer to the cleared entry, NULL if the submission queue is full
+ */
+struct io_uring_sqe *uring_get_sqe(uring_t *ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *ring->sq_tail + ring->sq_pending;
+    if (tail - head >= ring->entries) {         //file pleine
+        return NULL;
+    }
+
+    unsigned index = tail & *ring->sq_mask;
+    ring->sq_array[index] = index;
+    ring->sq_pending++;
+
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    return sqe;
+}
+
+/*!
+ * @brief uring_submit_and_wait submits the filled entries and waits for completions
+ * @param ring is a pointer to the ring
+ * @param wait_count is the number of completions to wait for
+ * @return the number of submitted entries, -1 in case of error
+ */
+int uring_submit_and_wait(uring_t *ring, unsigned wait_count) {
+    unsigned to_submit = ring->sq_pending;
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + to_submit, __ATOMIC_RELEASE);     //publication au noyau
+    ring->sq_pending = 0;
+
+    int result;
+    do {
+        result = syscall(__NR_io_uring_enter, ring->ring_fd, to_submit, wait_count, IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (result < 0 && errno == EINTR);
+
+    return result;
+}
+
+/*!
+ * @brief uring_peek_cqe gets the next completion, without waiting
+ * @param ring is a pointer to the ring
+ * @return a pointer to the completion, NULL if none is available
+ */
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &ring->cqes[head & *ring->cq_mask];
+}
+
+/*!
+ * @brief uring_cqe_seen releases the completion returned by uring_peek_cqe
+ * @param ring is a pointer to the ring
+ */
+void uring_cqe_seen(uring_t *ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
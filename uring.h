@@ -0,0 +1,34 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+
+typedef struct {
+    int ring_fd;
+    unsigned entries;
+    // Submission queue
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned sq_pending; // sqes filled but not submitted yet
+    // Completion queue
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    // Mappings
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} uring_t;
+
+int uring_init(uring_t *ring, unsigned entries);
+void uring_exit(uring_t *ring);
+struct io_uring_sqe *uring_get_sqe(uring_t *ring);
+int uring_submit_and_wait(uring_t *ring, unsigned wait_count);
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring);
+void uring_cqe_seen(uring_t *ring);
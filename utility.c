@@ -40,6 +40,28 @@ char *concat_path(char *result, char *prefix, char *suffix) {
 
 
 
+/*!
+ * @brief get_prefix_length computes the length of the part of a path that belongs to its root directory
+ * Paths in the files lists are built with concat_path, so the relative part starts right after
+ * the root and its separating /
+ * @param root the root directory of the tree (source or destination)
+ * @return the position of the relative path in the entries of the tree
+ */
+size_t get_prefix_length(char *root) {
+
+    if (root == NULL) {
+        return 0;
+    }
+
+    size_t root_len = strlen(root);
+    if (root_len > 0 && root[root_len - 1] == '/') {        //concat_path n'ajoute pas de '/' dans ce cas
+        return root_len;
+    }
+
+    return root_len + 1;            //on saute le '/' ajouté par concat_path
+}
+
+
 /*
 // test a sup : 
 
@@ -1,5 +1,7 @@
 #pragma once
 
 #include "defines.h"
+#include <stddef.h>
 
-char *concat_path(char *result, char *prefix, char *suffix);
\ No newline at end of file
+char *concat_path(char *result, char *prefix, char *suffix);
+size_t get_prefix_length(char *root);
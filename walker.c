@@ -0,0 +1,371 @@
+#include "walker.h"
+#include "work-deque.h"
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Parcours de l'arborescence relatif aux descripteurs des dossiers (openat/fstatat/getdents64) :
+// le noyau ne résout jamais que le nom de l'entrée, et le chemin complet n'est construit que
+// pour créer les entrées de la liste.
+// En mode multithread, chaque thread a sa propre liste et sa propre file de dossiers à parcourir ;
+// un thread sans travail vole des dossiers dans les files des autres. Les listes sont réunies à la fin.
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} path_buffer_t;
+
+typedef struct {
+    int dir_fd;
+    char *path; // path of the directory
+} walker_item_t;
+
+typedef struct _walker_pool walker_pool_t;
+
+typedef struct {
+    files_list_t list; // entries found by this thread
+    path_buffer_t path;
+    work_deque_t deque;
+    walker_pool_t *pool; // NULL when walking sequentially
+    bool failed; // a directory of this thread could not be walked entirely
+    int id;
+    pthread_t thread;
+} walker_thread_t;
+
+struct _walker_pool {
+    walker_thread_t *threads;
+    int threads_count;
+    atomic_size_t pending; // directories queued or being walked
+    atomic_size_t available; // directories queued
+    atomic_int sleepers;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+};
+
+/*!
+ * @brief push_name appends /name to the path buffer, growing it when needed
+ * @param path is a pointer to the path buffer
+ * @param name is the name to append
+ * @return the length of the path before the append (to restore it), -1 if out of memory
+ */
+static ssize_t push_name(path_buffer_t *path, const char *name) {
+    size_t old_length = path->length;
+    size_t name_length = strlen(name);
+    size_t needed = old_length + name_length + 2;
+
+    if (needed > path->capacity) {          //pas de limite PATH_SIZE : le tampon grandit
+        size_t new_capacity = path->capacity ? path->capacity : 256;
+        while (new_capacity < needed) {
+            new_capacity *= 2;
+        }
+        char *new_data = realloc(path->data, new_capacity);
+        if (!new_data) {
+            printf("out of memory\n");
+            return -1;
+        }
+        path->data = new_data;
+        path->capacity = new_capacity;
+    }
+
+    if (old_length > 0 && path->data[old_length - 1] != '/') {      //même règle que concat_path
+        path->data[path->length++] = '/';
+    }
+    memcpy(path->data + path->length, name, name_length + 1);
+    path->length += name_length;
+
+    return old_length;
+}
+
+static int walk_directory(walker_thread_t *self, int dir_fd);
+
+/*!
+ * @brief schedule_directory hands an opened directory to the pool, so that any thread can walk it
+ * @param self is the thread that found the directory
+ * @param dir_fd is the descriptor of the directory (owned by the pool on success)
+ * @return 0 if the directory was queued, -1 if the caller must walk it itself
+ */
+static int schedule_directory(walker_thread_t *self, int dir_fd) {
+    walker_pool_t *pool = self->pool;
+    if (!pool || atomic_load(&pool->available) >= WALKER_MAX_QUEUED_DIRS) {    //limite de descripteurs ouverts
+        return -1;
+    }
+
+    walker_item_t *item = malloc(sizeof(walker_item_t));
+    if (!item) {
+        return -1;
+    }
+    item->dir_fd = dir_fd;
+    item->path = strdup(self->path.data);
+    if (!item->path) {
+        free(item);
+        return -1;
+    }
+
+    atomic_fetch_add(&pool->pending, 1);
+    atomic_fetch_add(&pool->available, 1);         //avant la publication : un voleur le décrémente aussitôt
+    if (work_deque_push(&self->deque, item) == -1) {
+        atomic_fetch_sub(&pool->available, 1);
+        atomic_fetch_sub(&pool->pending, 1);
+        free(item->path);
+        free(item);
+        return -1;
+    }
+
+    if (atomic_load(&pool->sleepers) > 0) {         //réveil d'un thread en attente
+        pthread_mutex_lock(&pool->idle_lock);
+        pthread_cond_signal(&pool->idle_cond);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+    return 0;
+}
+
+/*!
+ * @brief walk_directory lists the content of an opened directory into the list of a thread
+ * Subdirectories are queued for the pool when possible, walked recursively else.
+ * @param self is the walking thread (its path buffer holds the path of the directory)
+ * @param dir_fd is the descriptor of the directory (closed by the caller)
+ * @return 0 if all went good, -1 else
+ */
+static int walk_directory(walker_thread_t *self, int dir_fd) {
+    path_buffer_t *path = &self->path;
+    char *buffer = malloc(WALKER_BUFFER_SIZE);
+    if (!buffer) {
+        printf("out of memory\n");
+        return -1;
+    }
+
+    int result = 0;
+    bool nested_failed = false;
+    long bytes;
+    while ((bytes = syscall(SYS_getdents64, dir_fd, buffer, WALKER_BUFFER_SIZE)) > 0) {
+        for (long offset = 0; offset < bytes;) {
+            struct linux_dirent64 *entry = (struct linux_dirent64 *)(buffer + offset);
+            offset += entry->d_reclen;
+
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {  //si c'est . ou .. on ignore
+                continue;
+            }
+
+            unsigned char type = entry->d_type;
+            if (type == DT_UNKNOWN) {               //type non fourni par le systeme de fichiers
+                struct stat stats;
+                if (fstatat(dir_fd, entry->d_name, &stats, AT_SYMLINK_NOFOLLOW) == -1) {
+                    continue;
+                }
+                type = S_ISDIR(stats.st_mode) ? DT_DIR : (S_ISREG(stats.st_mode) ? DT_REG : DT_UNKNOWN);
+            }
+            if (type != DT_DIR && type != DT_REG) {     //fichiers speciaux ignorés
+                continue;
+            }
+
+            ssize_t parent_length = push_name(path, entry->d_name);
+            if (parent_length == -1) {
+                result = -1;
+                break;
+            }
+
+            files_list_entry_t *list_entry = append_file_entry(&self->list, path->data);
+            if (!list_entry) {                      //liste pleine : elle serait incomplète
+                printf("Erreur lors de l'ajout de %s à la liste\n", path->data);
+                result = -1;
+                break;
+            }
+            list_entry->entry_type = (type == DT_DIR) ? DOSSIER : FICHIER;
+
+            if (type == DT_DIR) {
+                int child_fd = openat(dir_fd, entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                if (child_fd == -1) {
+                    printf("Erreur lors de l'ouverture du dossier %s\n", path->data);
+                    nested_failed = true;           //son contenu manque à la liste
+                } else if (schedule_directory(self, child_fd) == -1) {     //pas de file : on le parcourt nous-même
+                    if (walk_directory(self, child_fd) == -1) {
+                        nested_failed = true;       //la suite du dossier est tout de même parcourue
+                    }
+                    close(child_fd);
+                }
+            }
+
+            path->length = parent_length;           //retour au chemin du dossier
+            path->data[path->length] = '\0';
+        }
+        if (result == -1) {
+            break;
+        }
+    }
+
+    if (bytes == -1) {
+        printf("Erreur lors de la lecture du dossier %s\n", path->data);
+        result = -1;
+    }
+
+    free(buffer);
+    return nested_failed ? -1 : result;
+}
+
+/*!
+ * @brief next_item gets the next directory to walk: from the thread's own deque first, then by stealing
+ * It waits while other threads are still walking directories that may produce work.
+ * @param self is the thread looking for work
+ * @return the item, NULL when the whole tree has been walked
+ */
+static walker_item_t *next_item(walker_thread_t *self) {
+    walker_pool_t *pool = self->pool;
+
+    while (true) {
+        walker_item_t *item = work_deque_pop(&self->deque);
+        for (int i = 1; !item && i < pool->threads_count; ++i) {        //vol chez les autres threads
+            item = work_deque_steal(&pool->threads[(self->id + i) % pool->threads_count].deque);
+        }
+        if (item) {
+            atomic_fetch_sub(&pool->available, 1);
+            return item;
+        }
+
+        pthread_mutex_lock(&pool->idle_lock);
+        atomic_fetch_add(&pool->sleepers, 1);
+        while (atomic_load(&pool->available) == 0 && atomic_load(&pool->pending) > 0) {
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        }
+        atomic_fetch_sub(&pool->sleepers, 1);
+        bool finished = atomic_load(&pool->pending) == 0;
+        pthread_mutex_unlock(&pool->idle_lock);
+
+        if (finished) {
+            return NULL;
+        }
+    }
+}
+
+/*!
+ * @brief walker_thread_loop is the function of the walking threads
+ * @param parameters is a pointer to the walker_thread_t of the thread
+ */
+static void *walker_thread_loop(void *parameters) {
+    walker_thread_t *self = (walker_thread_t *)parameters;
+    walker_pool_t *pool = self->pool;
+    walker_item_t *item;
+
+    while ((item = next_item(self)) != NULL) {
+        self->path.length = 0;
+        if (push_name(&self->path, item->path) == -1 || walk_directory(self, item->dir_fd) == -1) {
+            self->failed = true;            //remonté par walk_tree
+        }
+        close(item->dir_fd);
+        free(item->path);
+        free(item);
+
+        if (atomic_fetch_sub(&pool->pending, 1) == 1) {         //dernier dossier : tout le monde s'arrête
+            pthread_mutex_lock(&pool->idle_lock);
+            pthread_cond_broadcast(&pool->idle_cond);
+            pthread_mutex_unlock(&pool->idle_lock);
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * @brief walk_tree lists all the files and directories under a target directory, unordered
+ * Paths of the entries are built like concat_path would (target/sub/name)
+ * @param list is a pointer to the list to fill
+ * @param target is the directory to walk
+ * @param threads_count is the number of walking threads (1 walks in the calling thread only)
+ * @return 0 if all went good, -1 else
+ */
+int walk_tree(files_list_t *list, char *target, int threads_count) {
+    if (!list || !target) {
+        printf("Invalid parameters\n");
+        return -1;
+    }
+    if (threads_count < 1) {
+        threads_count = 1;
+    }
+
+    int root_fd = open(target, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd == -1) {
+        printf("Erreur lors de l'ouverture du dossier %s\n", target);
+        return -1;
+    }
+
+    walker_pool_t pool;
+    pool.threads_count = threads_count;
+    pool.threads = calloc(threads_count, sizeof(walker_thread_t));
+    if (!pool.threads) {
+        printf("out of memory\n");
+        close(root_fd);
+        return -1;
+    }
+    atomic_init(&pool.pending, 0);
+    atomic_init(&pool.available, 0);
+    atomic_init(&pool.sleepers, 0);
+    pthread_mutex_init(&pool.idle_lock, NULL);
+    pthread_cond_init(&pool.idle_cond, NULL);
+
+    int result = 0;
+    for (int i = 0; i < threads_count; ++i) {
+        walker_thread_t *thread = &pool.threads[i];
+        thread->id = i;
+        thread->pool = (threads_count > 1) ? &pool : NULL;
+        init_shared_files_list(&thread->list, list->entries.region);     //même mémoire que la liste finale
+        if (init_work_deque(&thread->deque) == -1) {
+            result = -1;
+        }
+    }
+
+    walker_thread_t *first = &pool.threads[0];
+    if (result == -1 || push_name(&first->path, target) == -1) {
+        result = -1;
+    } else if (threads_count == 1) {            //parcours séquentiel dans le thread appelant
+        result = walk_directory(first, root_fd);
+    } else {
+        if (walk_directory(first, root_fd) == -1) {     //le dossier racine remplit la file du premier thread
+            result = -1;
+        }
+
+        int started = 1;
+        for (; started < threads_count; ++started) {
+            if (pthread_create(&pool.threads[started].thread, NULL, walker_thread_loop, &pool.threads[started]) != 0) {
+                printf("Erreur lors de la création d'un thread\n");
+                break;
+            }
+        }
+        walker_thread_loop(first);              //le thread appelant travaille aussi
+        for (int i = 1; i < started; ++i) {
+            pthread_join(pool.threads[i].thread, NULL);
+        }
+    }
+
+    for (int i = 0; i < threads_count; ++i) {   //réunion des listes et des erreurs de chaque thread
+        if (pool.threads[i].failed) {
+            result = -1;
+        }
+        merge_files_list(list, &pool.threads[i].list);
+        free(pool.threads[i].path.data);
+        if (pool.threads[i].deque.items) {
+            destroy_work_deque(&pool.threads[i].deque);
+        }
+    }
+
+    pthread_mutex_destroy(&pool.idle_lock);
+    pthread_cond_destroy(&pool.idle_cond);
+    free(pool.threads);
+    close(root_fd);
+    return result;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "files-list.h"
+
+#define WALKER_BUFFER_SIZE (64 * 1024)
+#define WALKER_MAX_QUEUED_DIRS 512 // open descriptors waiting in the deques
+
+int walk_tree(files_list_t *list, char *target, int threads_count);
@@ -0,0 +1,100 @@
+#include "work-deque.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+// File de travail à deux bouts (work-stealing) : le thread propriétaire empile et dépile par le bas
+// (ordre LIFO, les données sont encore en cache), les autres threads volent par le haut (les tâches
+// les plus anciennes, en général les plus grosses)
+
+#define WORK_DEQUE_INITIAL_CAPACITY 64
+
+/*!
+ * @brief init_work_deque initializes an empty deque
+ * @param deque is a pointer to the deque to initialize
+ * @return 0 if all went good, -1 else
+ */
+int init_work_deque(work_deque_t *deque) {
+    deque->items = malloc(WORK_DEQUE_INITIAL_CAPACITY * sizeof(void *));
+    if (!deque->items) {
+        printf("out of memory\n");
+        return -1;
+    }
+    deque->capacity = WORK_DEQUE_INITIAL_CAPACITY;
+    deque->top = deque->bottom = 0;
+    pthread_mutex_init(&deque->lock, NULL);
+    return 0;
+}
+
+/*!
+ * @brief destroy_work_deque releases a deque (the remaining items are not freed)
+ * @param deque is a pointer to the deque
+ */
+void destroy_work_deque(work_deque_t *deque) {
+    free(deque->items);
+    deque->items = NULL;
+    deque->capacity = deque->top = deque->bottom = 0;
+    pthread_mutex_destroy(&deque->lock);
+}
+
+/*!
+ * @brief work_deque_push adds an item at the bottom of the deque (owner side)
+ * @param deque is a pointer to the deque
+ * @param item is the item to add
+ * @return 0 if all went good, -1 else (out of memory)
+ */
+int work_deque_push(work_deque_t *deque, void *item) {
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->bottom - deque->top == deque->capacity) {        //pleine : on double la taille
+        void **new_items = malloc(2 * deque->capacity * sizeof(void *));
+        if (!new_items) {
+            pthread_mutex_unlock(&deque->lock);
+            printf("out of memory\n");
+            return -1;
+        }
+        for (size_t i = deque->top; i < deque->bottom; ++i) {
+            new_items[i % (2 * deque->capacity)] = deque->items[i % deque->capacity];
+        }
+        free(deque->items);
+        deque->items = new_items;
+        deque->capacity *= 2;
+    }
+
+    deque->items[deque->bottom % deque->capacity] = item;
+    deque->bottom++;
+
+    pthread_mutex_unlock(&deque->lock);
+    return 0;
+}
+
+/*!
+ * @brief work_deque_pop takes the last pushed item (owner side)
+ * @param deque is a pointer to the deque
+ * @return the item, NULL if the deque is empty
+ */
+void *work_deque_pop(work_deque_t *deque) {
+    void *item = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom != deque->top) {
+        deque->bottom--;
+        item = deque->items[deque->bottom % deque->capacity];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return item;
+}
+
+/*!
+ * @brief work_deque_steal takes the oldest item of the deque (thief side)
+ * @param deque is a pointer to the deque
+ * @return the item, NULL if the deque is empty
+ */
+void *work_deque_steal(work_deque_t *deque) {
+    void *item = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom != deque->top) {
+        item = deque->items[deque->top % deque->capacity];
+        deque->top++;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return item;
+}
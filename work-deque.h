@@ -0,0 +1,18 @@
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+typedef struct {
+    void **items; // circular buffer
+    size_t capacity;
+    size_t top; // next item to steal
+    size_t bottom; // next free slot for the owner
+    pthread_mutex_t lock;
+} work_deque_t;
+
+int init_work_deque(work_deque_t *deque);
+void destroy_work_deque(work_deque_t *deque);
+int work_deque_push(work_deque_t *deque, void *item);
+void *work_deque_pop(work_deque_t *deque);
+void *work_deque_steal(work_deque_t *deque);
@@ -0,0 +1,318 @@
+#include "xxh3.h"
+#include <string.h>
+
+// XXH3 128 bits (graine 0, secret par défaut), en flux : les entrées courtes (jusqu'à 240 octets) sont
+// gardées entières dans le tampon, les longues sont accumulées par bandes de 64 octets.
+// Le résultat est écrit dans l'ordre canonique (partie haute puis basse, gros-boutiste).
+
+#define PRIME32_1 0x9E3779B1U
+#define PRIME32_2 0x85EBCA77U
+#define PRIME32_3 0xC2B2AE3DU
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+#define PRIME_MX1 0x165667919E3779F9ULL
+#define PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define STRIPES_PER_BLOCK ((XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH) / 8)
+#define SECRET_LASTACC_START 7
+#define SECRET_MERGEACCS_START 11
+#define MIDSIZE_STARTOFFSET 3
+#define MIDSIZE_LASTOFFSET 17
+#define SECRET_SIZE_MIN 136
+
+static const uint8_t default_secret[XXH3_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+typedef struct {
+    uint64_t low;
+    uint64_t high;
+} uint128_pair_t;
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));           //x86 : petit-boutiste comme le format
+    return value;
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline uint128_pair_t mult64to128(uint64_t lhs, uint64_t rhs) {
+    unsigned __int128 product = (unsigned __int128)lhs * rhs;
+    uint128_pair_t result = {(uint64_t)product, (uint64_t)(product >> 64)};
+    return result;
+}
+
+static inline uint64_t mul128_fold64(uint64_t lhs, uint64_t rhs) {
+    uint128_pair_t product = mult64to128(lhs, rhs);
+    return product.low ^ product.high;
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t mix16(const uint8_t *input, const uint8_t *secret) {
+    return mul128_fold64(read64(input) ^ read64(secret), read64(input + 8) ^ read64(secret + 8));
+}
+
+static inline uint128_pair_t mix32(uint128_pair_t acc, const uint8_t *input1, const uint8_t *input2, const uint8_t *secret) {
+    acc.low += mix16(input1, secret);
+    acc.low ^= read64(input2) + read64(input2 + 8);
+    acc.high += mix16(input2, secret + 16);
+    acc.high ^= read64(input1) + read64(input1 + 8);
+    return acc;
+}
+
+/*!
+ * @brief hash_short computes the hash of an input up to 240 bytes
+ */
+static uint128_pair_t hash_short(const uint8_t *input, size_t length) {
+    const uint8_t *secret = default_secret;
+    uint128_pair_t h;
+
+    if (length == 0) {
+        h.low = xxh64_avalanche(read64(secret + 64) ^ read64(secret + 72));
+        h.high = xxh64_avalanche(read64(secret + 80) ^ read64(secret + 88));
+    } else if (length <= 3) {
+        uint32_t combined_low = ((uint32_t)input[0] << 16) | ((uint32_t)input[length >> 1] << 24)
+                                | input[length - 1] | ((uint32_t)length << 8);
+        uint32_t combined_high = rotl32(__builtin_bswap32(combined_low), 13);
+        uint64_t bitflip_low = read32(secret) ^ read32(secret + 4);
+        uint64_t bitflip_high = read32(secret + 8) ^ read32(secret + 12);
+        h.low = xxh64_avalanche(combined_low ^ bitflip_low);
+        h.high = xxh64_avalanche(combined_high ^ bitflip_high);
+    } else if (length <= 8) {
+        uint64_t input64 = read32(input) + ((uint64_t)read32(input + length - 4) << 32);
+        uint64_t bitflip = read64(secret + 16) ^ read64(secret + 24);
+        h = mult64to128(input64 ^ bitflip, PRIME64_1 + (length << 2));
+        h.high += h.low << 1;
+        h.low ^= h.high >> 3;
+        h.low ^= h.low >> 35;
+        h.low *= PRIME_MX2;
+        h.low ^= h.low >> 28;
+        h.high = xxh3_avalanche(h.high);
+    } else if (length <= 16) {
+        uint64_t bitflip_low = read64(secret + 32) ^ read64(secret + 40);
+        uint64_t bitflip_high = read64(secret + 48) ^ read64(secret + 56);
+        uint64_t input_low = read64(input);
+        uint64_t input_high = read64(input + length - 8);
+        uint128_pair_t m = mult64to128(input_low ^ input_high ^ bitflip_low, PRIME64_1);
+        m.low += (uint64_t)(length - 1) << 54;
+        input_high ^= bitflip_high;
+        m.high += input_high + (uint64_t)(uint32_t)input_high * (PRIME32_2 - 1);
+        m.low ^= __builtin_bswap64(m.high);
+        h = mult64to128(m.low, PRIME64_2);
+        h.high += m.high * PRIME64_2;
+        h.low = xxh3_avalanche(h.low);
+        h.high = xxh3_avalanche(h.high);
+    } else {
+        uint128_pair_t acc = {length * PRIME64_1, 0};
+        if (length <= 128) {
+            if (length > 32) {
+                if (length > 64) {
+                    if (length > 96) {
+                        acc = mix32(acc, input + 48, input + length - 64, secret + 96);
+                    }
+                    acc = mix32(acc, input + 32, input + length - 48, secret + 64);
+                }
+                acc = mix32(acc, input + 16, input + length - 32, secret + 32);
+            }
+            acc = mix32(acc, input, input + length - 16, secret);
+        } else {
+            size_t rounds = length / 32;
+            for (size_t i = 0; i < 4; ++i) {
+                acc = mix32(acc, input + 32 * i, input + 32 * i + 16, secret + 32 * i);
+            }
+            acc.low = xxh3_avalanche(acc.low);
+            acc.high = xxh3_avalanche(acc.high);
+            for (size_t i = 4; i < rounds; ++i) {
+                acc = mix32(acc, input + 32 * i, input + 32 * i + 16, secret + MIDSIZE_STARTOFFSET + 32 * (i - 4));
+            }
+            acc = mix32(acc, input + length - 16, input + length - 32, secret + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET - 16);
+        }
+        h.low = acc.low + acc.high;
+        h.high = acc.low * PRIME64_1 + acc.high * PRIME64_4 + length * PRIME64_2;
+        h.low = xxh3_avalanche(h.low);
+        h.high = 0 - xxh3_avalanche(h.high);
+    }
+    return h;
+}
+
+/*!
+ * @brief accumulate_stripe accumulates a 64 bytes stripe of input
+ */
+static inline void accumulate_stripe(uint64_t acc[8], const uint8_t *input, const uint8_t *secret) {
+    for (int i = 0; i < 8; ++i) {
+        uint64_t data = read64(input + 8 * i);
+        uint64_t key = data ^ read64(secret + 8 * i);
+        acc[i ^ 1] += data;
+        acc[i] += (uint64_t)(uint32_t)key * (key >> 32);
+    }
+}
+
+/*!
+ * @brief scramble_accumulators mixes the accumulators at the end of each block
+ */
+static inline void scramble_accumulators(uint64_t acc[8], const uint8_t *secret) {
+    for (int i = 0; i < 8; ++i) {
+        uint64_t value = acc[i];
+        value ^= value >> 47;
+        value ^= read64(secret + 8 * i);
+        value *= PRIME32_1;
+        acc[i] = value;
+    }
+}
+
+/*!
+ * @brief consume_stripes accumulates stripes, scrambling each time a block is complete
+ */
+static void consume_stripes(uint64_t acc[8], size_t *stripes_in_block, const uint8_t *input, size_t stripes) {
+    for (size_t i = 0; i < stripes; ++i) {
+        accumulate_stripe(acc, input + i * XXH3_STRIPE_LENGTH, default_secret + *stripes_in_block * 8);
+        if (++*stripes_in_block == STRIPES_PER_BLOCK) {
+            scramble_accumulators(acc, default_secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH);
+            *stripes_in_block = 0;
+        }
+    }
+}
+
+static uint64_t merge_accumulators(const uint64_t acc[8], const uint8_t *secret, uint64_t start) {
+    uint64_t result = start;
+    for (int i = 0; i < 4; ++i) {
+        result += mul128_fold64(acc[2 * i] ^ read64(secret + 16 * i), acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+    }
+    return xxh3_avalanche(result);
+}
+
+/*!
+ * @brief xxh3_128_init initializes a XXH3-128 hashing state
+ * @param state is a pointer to the state
+ */
+void xxh3_128_init(xxh3_state_t *state) {
+    state->acc[0] = PRIME32_3;
+    state->acc[1] = PRIME64_1;
+    state->acc[2] = PRIME64_2;
+    state->acc[3] = PRIME64_3;
+    state->acc[4] = PRIME64_4;
+    state->acc[5] = PRIME32_2;
+    state->acc[6] = PRIME64_5;
+    state->acc[7] = PRIME32_1;
+    state->buffered = 0;
+    state->stripes_in_block = 0;
+    state->total_length = 0;
+}
+
+/*!
+ * @brief xxh3_128_update feeds data into a XXH3-128 hashing state
+ * The buffer is only consumed when more input follows, so that the last stripe is always available at the end.
+ * @param state is a pointer to the state
+ * @param data is the data to hash
+ * @param length is the length of data
+ */
+void xxh3_128_update(xxh3_state_t *state, const void *data, size_t length) {
+    const uint8_t *input = data;
+    state->total_length += length;
+
+    if (state->buffered + length <= XXH3_BUFFER_SIZE) {         //tout tient dans le tampon
+        memcpy(state->buffer + state->buffered, input, length);
+        state->buffered += length;
+        return;
+    }
+
+    if (state->buffered > 0) {                  //compléter le tampon puis l'accumuler
+        size_t fill = XXH3_BUFFER_SIZE - state->buffered;
+        memcpy(state->buffer + state->buffered, input, fill);
+        input += fill;
+        length -= fill;
+        consume_stripes(state->acc, &state->stripes_in_block, state->buffer, XXH3_BUFFER_SIZE / XXH3_STRIPE_LENGTH);
+        state->buffered = 0;
+    }
+
+    if (length > XXH3_BUFFER_SIZE) {            //bandes directement depuis l'entrée, en gardant toujours la fin
+        size_t stripes = (length - 1) / XXH3_STRIPE_LENGTH;
+        consume_stripes(state->acc, &state->stripes_in_block, input, stripes);
+        input += stripes * XXH3_STRIPE_LENGTH;
+        length -= stripes * XXH3_STRIPE_LENGTH;
+        memcpy(state->buffer + XXH3_BUFFER_SIZE - XXH3_STRIPE_LENGTH, input - XXH3_STRIPE_LENGTH, XXH3_STRIPE_LENGTH);
+    }
+
+    memcpy(state->buffer, input, length);
+    state->buffered = length;
+}
+
+/*!
+ * @brief xxh3_128_final computes the digest of all the data fed into the state
+ * @param state is a pointer to the state (left unchanged)
+ * @param digest is the resulting 16 bytes digest (canonical order)
+ */
+void xxh3_128_final(xxh3_state_t *state, uint8_t digest[16]) {
+    uint128_pair_t h;
+    uint64_t length = state->total_length;
+
+    if (length <= XXH3_MIDSIZE_MAX) {
+        h = hash_short(state->buffer, length);
+    } else {
+        uint64_t acc[8];
+        size_t stripes_in_block = state->stripes_in_block;
+        memcpy(acc, state->acc, sizeof(acc));
+
+        uint8_t last_stripe[XXH3_STRIPE_LENGTH];
+        if (state->buffered >= XXH3_STRIPE_LENGTH) {
+            consume_stripes(acc, &stripes_in_block, state->buffer, (state->buffered - 1) / XXH3_STRIPE_LENGTH);
+            memcpy(last_stripe, state->buffer + state->buffered - XXH3_STRIPE_LENGTH, XXH3_STRIPE_LENGTH);
+        } else {                                //fin de la bande précédente restée en fin de tampon
+            size_t missing = XXH3_STRIPE_LENGTH - state->buffered;
+            memcpy(last_stripe, state->buffer + XXH3_BUFFER_SIZE - missing, missing);
+            memcpy(last_stripe + missing, state->buffer, state->buffered);
+        }
+        accumulate_stripe(acc, last_stripe, default_secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH - SECRET_LASTACC_START);
+
+        h.low = merge_accumulators(acc, default_secret + SECRET_MERGEACCS_START, length * PRIME64_1);
+        h.high = merge_accumulators(acc, default_secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH - SECRET_MERGEACCS_START,
+                                    ~(length * PRIME64_2));
+    }
+
+    for (int i = 0; i < 8; ++i) {               //ordre canonique : gros-boutiste, partie haute d'abord
+        digest[i] = (uint8_t)(h.high >> (56 - 8 * i));
+        digest[8 + i] = (uint8_t)(h.low >> (56 - 8 * i));
+    }
+}
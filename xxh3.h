@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define XXH3_SECRET_SIZE 192
+#define XXH3_STRIPE_LENGTH 64
+#define XXH3_BUFFER_SIZE 256
+#define XXH3_MIDSIZE_MAX 240
+
+typedef struct {
+    uint64_t acc[8];
+    uint8_t buffer[XXH3_BUFFER_SIZE]; // pending input (the whole input while it is short)
+    size_t buffered;
+    size_t stripes_in_block; // stripes accumulated since the last scramble
+    uint64_t total_length;
+} xxh3_state_t;
+
+void xxh3_128_init(xxh3_state_t *state);
+void xxh3_128_update(xxh3_state_t *state, const void *data, size_t length);
+void xxh3_128_final(xxh3_state_t *state, uint8_t digest[16]);